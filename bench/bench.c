@@ -0,0 +1,584 @@
+/*
+    Benchmark suite for the decision tree hot paths.
+
+    Usage: bench [--min-rows N] [--max-rows N] [--repeat R] [--seed S] [--output file.json]
+
+    Synthetic datasets (synth.h, default parameters) are generated for row counts from
+    --min-rows to --max-rows (x10 steps, default 1K to 1M; up to 100M with enough memory). For each size it times:
+        input_read              loader (input_read_file on a temporary text file)
+        find_best_attribute     split search at the root
+        begin_training          full ID3 training
+        test_case               unbatched prediction (one ID3_test_case call per record)
+        predict_batch           batched prediction (ID3_predict_batch)
+        predict_compact         prediction on the compact inference tree (ID3_predict_compact)
+        collapse_records        duplicate-row pre-aggregation (ID3_collapse_training_set)
+        begin_training_collapsed  ID3 training on the weighted distinct records
+        add_record              incremental training (ID3_add_record) of the rows after the
+                                first BENCH_INCREMENTAL_BASE_RATIO (sizes up to
+                                BENCH_INCREMENTAL_MAX_ROWS only), checked against a full
+                                retrain every BENCH_INCREMENTAL_CHECKPOINTS-th of the way
+        load_train_sequential   input_read_file, ID3_generate_problem then ID3_begin_training
+        load_train_pipelined    pipeline_load then ID3_begin_training_counts (pipeline.h)
+
+    Results (seconds, throughput, ns/record, peak RSS, allocation counts) are written
+    as JSON to stdout or --output, a short table goes to stderr. The exit status is 1
+    if incremental training did not give the same tree as a full retrain.
+    The number of attributes is fixed at NUM_ATTRIBUTES by the input format.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <input.h>
+#include <tree.h>
+#include <ID3.h>
+#include <synth.h>
+#include <pipeline.h>
+
+#define BENCH_DEFAULT_MIN_ROWS 1000
+#define BENCH_DEFAULT_MAX_ROWS 1000000
+
+// Incremental training: rows trained up front, and number of full-retrain checks
+#define BENCH_INCREMENTAL_BASE_RATIO  0.05
+#define BENCH_INCREMENTAL_CHECKPOINTS 10
+#define BENCH_INCREMENTAL_MAX_ROWS    20000
+
+#ifdef BENCH_COUNT_ALLOCS
+// Allocation counters, fed by the linker-wrapped allocator (see CMakeLists.txt)
+static uint64_t alloc_count = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+#endif
+
+typedef struct bench_result {
+    const char* name;
+    long long   rows;
+    double      seconds;
+    long long   allocations;
+    long        peak_rss_kb;
+} bench_result;
+
+typedef struct bench_report {
+    bench_result* results;
+    int           count;
+    int           capacity;
+} bench_report;
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long long alloc_snapshot() {
+#ifdef BENCH_COUNT_ALLOCS
+    return (long long)__atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+#else
+    return -1;
+#endif
+}
+
+static long peak_rss_kb() {
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+    return usage.ru_maxrss;
+}
+
+static void report_add(bench_report* report, const char* name, long long rows, double seconds, long long allocations) {
+    if(report->count == report->capacity) {
+        int new_capacity = report->capacity > 0 ? report->capacity * 2 : 16;
+        bench_result* new_results = (bench_result*)realloc(report->results, new_capacity * sizeof(bench_result));
+        if(new_results == NULL) {
+            fprintf(stderr, "Error at report_add: memory allocation failed.\n");
+            return;
+        }
+        report->results = new_results;
+        report->capacity = new_capacity;
+    }
+
+    bench_result* result = &report->results[report->count++];
+    result->name = name;
+    result->rows = rows;
+    result->seconds = seconds;
+    result->allocations = allocations;
+    result->peak_rss_kb = peak_rss_kb();
+
+    fprintf(stderr, "%-24s %12lld rows %10.4f s %14.0f rec/s %10.2f ns/rec\n",
+            name, rows, seconds, seconds > 0 ? rows / seconds : 0.0, seconds * 1e9 / rows);
+}
+
+static int write_records(const char* path, const input_record* records, int num_records) {
+    FILE* file = fopen(path, "w");
+    if(file == NULL) {
+        perror("Error opening file");
+        return -1;
+    }
+
+    int status = input_write_records(file, records, num_records);
+    fclose(file);
+    return status;
+}
+
+// End-to-end job latency from the file to a trained tree, with and without the pipelined loader
+static void bench_load_and_train(bench_report* report, const char* path, int num_records, int repeat) {
+    double best_sequential = -1.0, best_pipelined = -1.0;
+    long long allocs_sequential = 0, allocs_pipelined = 0;
+
+    for(int r = 0; r < repeat; r++) {
+        long long allocs_before = alloc_snapshot();
+        double start = now_seconds();
+        int loaded = 0;
+        input_record* records = input_read_file(path, &loaded);
+        ID3_problem* problem = records != NULL ? ID3_generate_problem(records, loaded) : NULL;
+        free(records);
+        if(problem != NULL)
+            ID3_begin_training(problem, problem->training_set_size);
+        double elapsed = now_seconds() - start;
+        allocs_sequential = alloc_snapshot() - allocs_before;
+        if(problem == NULL)
+            return;
+        tree_delete(problem->root);
+        problem->root = NULL;
+        ID3_free_problem(problem);
+        if(best_sequential < 0 || elapsed < best_sequential)
+            best_sequential = elapsed;
+
+        allocs_before = alloc_snapshot();
+        start = now_seconds();
+        long long* root_counts = NULL;
+        int test_size = 0;
+        problem = pipeline_load(path, PIPELINE_DEFAULT_SEED, 0, &root_counts, &test_size);
+        if(problem != NULL)
+            ID3_begin_training_counts(problem, problem->training_set_size, root_counts);
+        elapsed = now_seconds() - start;
+        allocs_pipelined = alloc_snapshot() - allocs_before;
+        if(problem == NULL)
+            return;
+        tree_delete(problem->root);
+        problem->root = NULL;
+        ID3_free_problem(problem);
+        if(best_pipelined < 0 || elapsed < best_pipelined)
+            best_pipelined = elapsed;
+    }
+
+    report_add(report, "load_train_sequential", num_records, best_sequential, allocs_sequential);
+    report_add(report, "load_train_pipelined", num_records, best_pipelined, allocs_pipelined);
+}
+
+static void bench_input_read(bench_report* report, const input_record* records, int num_records, int repeat) {
+    char path[] = "/tmp/decisiontree_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0) {
+        perror("Error creating temporary file");
+        return;
+    }
+    close(fd);
+
+    if(write_records(path, records, num_records) == 0) {
+        double best = -1.0;
+        long long allocations = 0;
+        for(int r = 0; r < repeat; r++) {
+            int loaded = 0;
+            long long allocs_before = alloc_snapshot();
+            double start = now_seconds();
+            input_record* result = input_read_file(path, &loaded);
+            double elapsed = now_seconds() - start;
+            allocations = alloc_snapshot() - allocs_before;
+            free(result);
+
+            if(loaded != num_records)
+                fprintf(stderr, "Warning: input_read loaded %d of %d records.\n", loaded, num_records);
+            if(best < 0 || elapsed < best)
+                best = elapsed;
+        }
+        report_add(report, "input_read", num_records, best, allocations);
+        bench_load_and_train(report, path, num_records, repeat);
+    }
+
+    unlink(path);
+}
+
+static void bench_find_best_attribute(bench_report* report, const input_record* records, int num_records, int repeat) {
+    int all_attrs[NUM_ATTRIBUTES];
+    for(int i = 0; i < NUM_ATTRIBUTES; i++)
+        all_attrs[i] = i;
+
+    double best = -1.0;
+    long long allocations = 0;
+    for(int r = 0; r < repeat; r++) {
+        long long allocs_before = alloc_snapshot();
+        double start = now_seconds();
+        volatile int attr = ID3_find_best_attribute(records, num_records, all_attrs, NUM_ATTRIBUTES);
+        double elapsed = now_seconds() - start;
+        allocations = alloc_snapshot() - allocs_before;
+        (void)attr;
+
+        if(best < 0 || elapsed < best)
+            best = elapsed;
+    }
+    report_add(report, "find_best_attribute", num_records, best, allocations);
+}
+
+// Trains on the whole dataset; returns the trained problem (caller frees)
+static ID3_problem* bench_training(bench_report* report, input_record* records, int num_records, int repeat) {
+    ID3_problem* problem = NULL;
+    double best = -1.0;
+    long long allocations = 0;
+
+    for(int r = 0; r < repeat; r++) {
+        if(problem != NULL) {
+            tree_delete(problem->root);
+            problem->root = NULL;
+        } else {
+            problem = ID3_create_problem(NULL, records, NULL, 1);
+            if(problem == NULL)
+                return NULL;
+            problem->training_set_size = num_records;
+            problem->training_set_capacity = num_records;
+        }
+
+        long long allocs_before = alloc_snapshot();
+        double start = now_seconds();
+        ID3_begin_training(problem, num_records);
+        double elapsed = now_seconds() - start;
+        allocations = alloc_snapshot() - allocs_before;
+
+        if(best < 0 || elapsed < best)
+            best = elapsed;
+    }
+    report_add(report, "begin_training", num_records, best, allocations);
+    return problem;
+}
+
+// Collapses duplicates then trains on the weighted records
+static void bench_collapsed_training(bench_report* report, const input_record* records, int num_records, int repeat) {
+    double best_collapse = -1.0, best_training = -1.0;
+    long long allocs_collapse = 0, allocs_training = 0;
+
+    for(int r = 0; r < repeat; r++) {
+        input_record* copy = (input_record*)malloc((size_t)num_records * sizeof(input_record));
+        if(copy == NULL) {
+            fprintf(stderr, "Error at bench_collapsed_training: memory allocation failed.\n");
+            return;
+        }
+        memcpy(copy, records, (size_t)num_records * sizeof(input_record));
+
+        ID3_problem* problem = ID3_create_problem(NULL, copy, NULL, 1);
+        if(problem == NULL) {
+            free(copy);
+            return;
+        }
+        problem->training_set_size = num_records;
+        problem->training_set_capacity = num_records;
+
+        long long allocs_before = alloc_snapshot();
+        double start = now_seconds();
+        int status = ID3_collapse_training_set(problem);
+        double elapsed = now_seconds() - start;
+        allocs_collapse = alloc_snapshot() - allocs_before;
+        if(best_collapse < 0 || elapsed < best_collapse)
+            best_collapse = elapsed;
+
+        if(status == 0) {
+            allocs_before = alloc_snapshot();
+            start = now_seconds();
+            ID3_begin_training(problem, problem->training_set_size);
+            elapsed = now_seconds() - start;
+            allocs_training = alloc_snapshot() - allocs_before;
+            if(best_training < 0 || elapsed < best_training)
+                best_training = elapsed;
+        }
+
+        tree_delete(problem->root);
+        problem->root = NULL;
+        ID3_free_problem(problem);
+    }
+
+    report_add(report, "collapse_records", num_records, best_collapse, allocs_collapse);
+    if(best_training >= 0)
+        report_add(report, "begin_training_collapsed", num_records, best_training, allocs_training);
+}
+
+// Same structure, split attributes and leaf labels
+static int same_tree(const tree_node* a, const tree_node* b) {
+    if(a == NULL || b == NULL)
+        return a == b;
+    if(a->kind != b->kind || a->children_count != b->children_count)
+        return 0;
+    if(a->kind == NODE_LEAF)
+        return a->class_label == b->class_label;
+    if(a->decision_attr_index != b->decision_attr_index)
+        return 0;
+
+    for(int c = 0; c < a->children_count; c++)
+        if(!same_tree(a->children[c], b->children[c]))
+            return 0;
+    return 1;
+}
+
+// Full retrain on the first num_records records, compared with the incremental tree
+static int matches_retrain(const tree_node* root, const input_record* records, int num_records) {
+    input_record* copy = (input_record*)malloc((size_t)num_records * sizeof(input_record));
+    ID3_problem* problem = copy != NULL ? ID3_create_problem(NULL, copy, NULL, 1) : NULL;
+    if(problem == NULL) {
+        fprintf(stderr, "Error at matches_retrain: memory allocation failed.\n");
+        free(copy);
+        return 0;
+    }
+    memcpy(copy, records, (size_t)num_records * sizeof(input_record));
+    problem->training_set_size = num_records;
+    problem->training_set_capacity = num_records;
+
+    ID3_begin_training(problem, num_records);
+    int same = same_tree(root, problem->root);
+
+    tree_delete(problem->root);
+    problem->root = NULL;
+    ID3_free_problem(problem);
+    return same;
+}
+
+// Trains on the first rows, then adds the others one at a time with ID3_add_record;
+// returns the number of checkpoints where the tree differs from a full retrain
+static int bench_incremental_training(bench_report* report, const input_record* records, int num_records) {
+    int base = (int)(num_records * BENCH_INCREMENTAL_BASE_RATIO);
+    if(base < 1)
+        base = 1;
+    if(base >= num_records)
+        return 0;
+
+    input_record* copy = (input_record*)malloc((size_t)base * sizeof(input_record));
+    ID3_problem* problem = copy != NULL ? ID3_create_problem(NULL, copy, NULL, 1) : NULL;
+    if(problem == NULL) {
+        fprintf(stderr, "Error at bench_incremental_training: memory allocation failed.\n");
+        free(copy);
+        return 0;
+    }
+    memcpy(copy, records, (size_t)base * sizeof(input_record));
+    problem->training_set_size = base;
+    problem->training_set_capacity = base;
+    ID3_begin_training(problem, base);
+
+    int step = (num_records - base + BENCH_INCREMENTAL_CHECKPOINTS - 1) / BENCH_INCREMENTAL_CHECKPOINTS;
+    int mismatches = 0;
+    double elapsed = 0.0;
+    long long allocations = 0;
+
+    for(int added = base; added < num_records; ) {
+        int checkpoint = added + step < num_records ? added + step : num_records;
+
+        long long allocs_before = alloc_snapshot();
+        double start = now_seconds();
+        for(; added < checkpoint; added++) {
+            if(ID3_add_record(problem, &records[added]) != 0)
+                break;
+        }
+        elapsed += now_seconds() - start;
+        allocations += alloc_snapshot() - allocs_before;
+
+        if(added < checkpoint || !matches_retrain(problem->root, records, added)) {
+            fprintf(stderr, "Error at bench_incremental_training: tree after %d rows differs from a full retrain.\n", added);
+            mismatches++;
+            if(added < checkpoint)
+                break;
+        }
+    }
+
+    report_add(report, "add_record", num_records - base, elapsed, allocations);
+
+    tree_delete(problem->root);
+    problem->root = NULL;
+    ID3_free_problem(problem);
+    return mismatches;
+}
+
+static void bench_prediction(bench_report* report, tree_node* root, input_record* records, int num_records, int repeat) {
+    int* labels = (int*)malloc((size_t)num_records * sizeof(int));
+    if(labels == NULL) {
+        fprintf(stderr, "Error at bench_prediction: memory allocation failed.\n");
+        return;
+    }
+
+    double best_single = -1.0, best_batch = -1.0;
+    long long allocs_single = 0, allocs_batch = 0;
+    for(int r = 0; r < repeat; r++) {
+        long long allocs_before = alloc_snapshot();
+        double start = now_seconds();
+        for(int i = 0; i < num_records; i++)
+            labels[i] = ID3_test_case(root, &records[i]);
+        double elapsed = now_seconds() - start;
+        allocs_single = alloc_snapshot() - allocs_before;
+        if(best_single < 0 || elapsed < best_single)
+            best_single = elapsed;
+
+        allocs_before = alloc_snapshot();
+        start = now_seconds();
+        ID3_predict_batch(root, records, num_records, labels);
+        elapsed = now_seconds() - start;
+        allocs_batch = alloc_snapshot() - allocs_before;
+        if(best_batch < 0 || elapsed < best_batch)
+            best_batch = elapsed;
+    }
+
+    report_add(report, "test_case", num_records, best_single, allocs_single);
+    report_add(report, "predict_batch", num_records, best_batch, allocs_batch);
+
+    ID3_compact_tree* compact = ID3_compact_tree_create(root);
+    if(compact != NULL) {
+        double best_compact = -1.0;
+        long long allocs_compact = 0;
+        for(int r = 0; r < repeat; r++) {
+            long long allocs_before = alloc_snapshot();
+            double start = now_seconds();
+            ID3_predict_compact(compact, records, num_records, labels);
+            double elapsed = now_seconds() - start;
+            allocs_compact = alloc_snapshot() - allocs_before;
+            if(best_compact < 0 || elapsed < best_compact)
+                best_compact = elapsed;
+        }
+        report_add(report, "predict_compact", num_records, best_compact, allocs_compact);
+        ID3_compact_tree_free(compact);
+    }
+    free(labels);
+}
+
+static void write_json(FILE* out, const bench_report* report, uint64_t seed, int repeat) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"decisiontree\",\n");
+    fprintf(out, "  \"attributes\": %d,\n", NUM_ATTRIBUTES);
+    fprintf(out, "  \"seed\": %llu,\n", (unsigned long long)seed);
+    fprintf(out, "  \"repeat\": %d,\n", repeat);
+    fprintf(out, "  \"results\": [\n");
+
+    for(int i = 0; i < report->count; i++) {
+        const bench_result* result = &report->results[i];
+        double seconds = result->seconds;
+        fprintf(out, "    {\"name\": \"%s\", \"rows\": %lld, \"seconds\": %.9f, "
+                     "\"records_per_sec\": %.1f, \"ns_per_record\": %.3f, "
+                     "\"peak_rss_kb\": %ld, \"allocations\": %lld}%s\n",
+                result->name, result->rows, seconds,
+                seconds > 0 ? result->rows / seconds : 0.0,
+                result->rows > 0 ? seconds * 1e9 / result->rows : 0.0,
+                result->peak_rss_kb, result->allocations,
+                i + 1 < report->count ? "," : "");
+    }
+
+    fprintf(out, "  ]\n}\n");
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--min-rows N] [--max-rows N] [--repeat R] [--seed S] [--output file.json]\n", program);
+}
+
+int main(int argc, char** argv) {
+    long long min_rows = BENCH_DEFAULT_MIN_ROWS;
+    long long max_rows = BENCH_DEFAULT_MAX_ROWS;
+    int repeat = 1;
+    uint64_t seed = SYNTH_DEFAULT_SEED;
+    const char* output_path = NULL;
+
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if(strcmp(argv[i], "--min-rows") == 0)
+            min_rows = atoll(argv[++i]);
+        else if(strcmp(argv[i], "--max-rows") == 0)
+            max_rows = atoll(argv[++i]);
+        else if(strcmp(argv[i], "--repeat") == 0)
+            repeat = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "--output") == 0)
+            output_path = argv[++i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(min_rows <= 0 || max_rows < min_rows || max_rows > 0x7fffffff || repeat <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    synth_params params = synth_default_params();
+    params.seed = seed;
+    synth_generator* generator = synth_create(&params);
+    if(generator == NULL)
+        return 1;
+
+    bench_report report = { NULL, 0, 0 };
+    int mismatches = 0;
+
+    for(long long rows = min_rows; rows <= max_rows; rows *= 10) {
+        int num_records = (int)rows;
+        input_record* records = (input_record*)malloc((size_t)num_records * sizeof(input_record));
+        if(records == NULL) {
+            fprintf(stderr, "Error at main: memory allocation failed.\n");
+            break;
+        }
+        synth_generate(generator, 0, num_records, records);
+
+        bench_input_read(&report, records, num_records, repeat);
+        bench_find_best_attribute(&report, records, num_records, repeat);
+
+        ID3_problem* problem = bench_training(&report, records, num_records, repeat);
+        if(problem != NULL) {
+            bench_prediction(&report, problem->root, records, num_records, repeat);
+            tree_delete(problem->root);
+            problem->root = NULL;
+            problem->training_set = NULL;
+            ID3_free_problem(problem);
+        }
+
+        bench_collapsed_training(&report, records, num_records, repeat);
+        if(num_records <= BENCH_INCREMENTAL_MAX_ROWS)
+            mismatches += bench_incremental_training(&report, records, num_records);
+
+        free(records);
+    }
+
+    synth_free(generator);
+
+    FILE* out = stdout;
+    if(output_path != NULL) {
+        out = fopen(output_path, "w");
+        if(out == NULL) {
+            perror("Error opening output file");
+            free(report.results);
+            return 1;
+        }
+    }
+
+    write_json(out, &report, seed, repeat);
+
+    if(out != stdout)
+        fclose(out);
+    free(report.results);
+    return mismatches > 0 ? 1 : 0;
+}
@@ -8,17 +8,44 @@
 
 #define TRAINING_SET_RATIO 0.8
 
+// Per-node count table layout (stored in tree_node->counts)
+// [0 .. ID3_NUM_CLASSES-1]: number of samples of each class
+// then, for every attribute and value (NO/YES): number of samples of each class
+#define ID3_NUM_CLASSES 2
+#define ID3_COUNTS_SIZE (ID3_NUM_CLASSES + NUM_ATTRIBUTES * 2 * ID3_NUM_CLASSES)
+#define ID3_CLASS_COUNT(counts, label) ((counts)[(label)])
+#define ID3_ATTR_COUNT(counts, attr, value, label) \
+    ((counts)[ID3_NUM_CLASSES + ((attr) * 2 + (value)) * ID3_NUM_CLASSES + (label)])
+
+// Split scores are computed from integer counts with a n*log2(n) lookup table
+// (exact computation above the table size). With ID3_FIXED_POINT (CMake option)
+// scores are 64-bit fixed point computed with integer arithmetic only, so split
+// choices are bit-reproducible across compilers, libm versions and thread layouts.
+#define ID3_NLOGN_TABLE_SIZE 4096
+#ifdef ID3_FIXED_POINT
+#define ID3_FIXED_POINT_SHIFT 20
+typedef long long ID3_score;
+#else
+typedef double ID3_score;
+#endif
+
 // Problem struct for ID3 algorithm
 // members:
 // tree_node* root: Root of the decision tree
 // input_record* training_set: Training dataset
 // input_record* testing_set: Testing dataset
 // int training_set_ratio: Ratio of training set size to total dataset size
+// int training_set_size: Number of records in the training set
+// int training_set_capacity: Allocated size of the training set (grows with ID3_add_record)
+// long long* training_weights: Weight of each training record, NULL if all weigh 1 (see ID3_collapse_training_set)
 typedef struct ID3_problem {
     tree_node* root;
     input_record* training_set;
     input_record* testing_set;
     int training_set_ratio;
+    int training_set_size;
+    int training_set_capacity;
+    long long* training_weights;
 
 } ID3_problem;
 
@@ -44,21 +71,102 @@ float ID3_get_information_gain(const input_record* records, int num_records, int
 // Encontra o melhor atributo (maior ganho de informação)
 int ID3_find_best_attribute(const input_record* records, int num_records, const int* available_attributes, int num_available);
 
+// Fills counts (ID3_COUNTS_SIZE entries) with the count table of the given samples,
+// each sample counting for its weight (1 if weights is NULL)
+void ID3_get_counts(const input_record* training_set, const long long* weights,
+                    const int* sample_indices, int num_samples, long long* counts);
+
+// n*log2(n) (0 for n <= 1)
+ID3_score ID3_nlogn(long long n);
+
+// Weighted entropy of a split, scaled by the number of samples: sum_v |S_v| * H(S_v)
+// Lower is better; each call costs six table lookups
+ID3_score ID3_split_score(const long long* counts, int attribute_index);
+
+// Information gain of an attribute computed from a count table
+float ID3_get_information_gain_counts(const long long* counts, int attribute_index);
+
+// Best attribute computed from a count table, or -1 if none
+int ID3_find_best_attribute_counts(const long long* counts, const int* available_attributes, int num_available);
+
 // Trains the decision tree using ID3 algorithm on the problem's training set
 // The root will be created and stored in problem->root
 void ID3_begin_training(ID3_problem* problem, int train_size);
 
+// Same as ID3_begin_training with the root count table already computed (e.g. while
+// loading, see pipeline.h); takes ownership of root_counts (computed here if NULL)
+void ID3_begin_training_counts(ID3_problem* problem, int train_size, long long* root_counts);
+
 // Recursive ID3 training function
 // Uses indices to reference samples in the training set (memory efficient)
+// Internal nodes always get both children: a branch no sample reaches becomes a
+// leaf with the node's majority class (sample_count 0)
+// weights: weight of each training record, NULL if all weigh 1
+// sample_indices stays owned by the caller (nodes keep their own copy)
 void ID3_train_rec(tree_node** node_ptr,
                    input_record* training_set,
+                   const long long* weights,
                    int* sample_indices,
                    int num_samples,
                    int* available_attributes,
                    int num_available_attributes);
 
+// Replaces the training set by its distinct records, each weighted by its number
+// of occurrences (see input_collapse_records). Must be called before training;
+// entropy, gain, majority and purity then work on weighted counts.
+// The raw training set has to be loaded first: pipeline_load collapses while
+// reading instead, so its memory grows with the distinct records only.
+// Returns 0 on success, -1 on error
+int ID3_collapse_training_set(ID3_problem* problem);
+
+// Incremental training: appends a new labelled record to the training set and
+// updates the tree in place. Count tables along the record's path are updated and
+// only the subtree whose best split changed (or leaf that became impure) is rebuilt,
+// so the result is the same tree a full retrain on the whole training set would give.
+// Returns 0 on success, -1 on error
+int ID3_add_record(ID3_problem* problem, const input_record* record);
+
 float ID3_begin_testing(ID3_problem* problem, int test_size);
                    
 int ID3_test_case(tree_node* node, input_record* record);
 
+// Batched prediction: classifies num_records records into labels[]
+// Iterative traversal; a missing child silently falls back to DEMOCRAT
+void ID3_predict_batch(const tree_node* root, const input_record* records, int num_records, int* labels);
+
+// Compact inference tree: a flat, read-only copy of a trained tree for fast scoring.
+// Nodes are stored breadth-first in one array. A leaf points to itself on both
+// branches, so ID3_predict_compact walks groups of records in lockstep for a fixed
+// number of steps (the depth), overlapping their cache misses.
+// members:
+// int attr_index: Split attribute (0 for a leaf)
+// int children[2]: YES/NO child indices (the node itself for a leaf)
+// int class_label: Class of a leaf
+typedef struct ID3_compact_node {
+    int attr_index;
+    int children[2];
+    int class_label;
+} ID3_compact_node;
+
+typedef struct ID3_compact_tree {
+    ID3_compact_node* nodes;
+    int               num_nodes;
+    int               depth;
+} ID3_compact_tree;
+
+// Records walked in lockstep by ID3_predict_compact
+#define ID3_COMPACT_GROUP 8
+
+// Builds the compact copy of a tree (missing children become DEMOCRAT leaves, as in
+// ID3_predict_batch), returns NULL on error
+ID3_compact_tree* ID3_compact_tree_create(const tree_node* root);
+
+// Copy of a compact tree; its pages land on the NUMA node of the calling thread
+ID3_compact_tree* ID3_compact_tree_clone(const ID3_compact_tree* tree);
+
+void ID3_compact_tree_free(ID3_compact_tree* tree);
+
+// Same labels as ID3_predict_batch on the original tree
+void ID3_predict_compact(const ID3_compact_tree* tree, const input_record* records, int num_records, int* labels);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef BOOST_H
+#define BOOST_H
+
+#include <input.h>
+
+#define BOOST_DEFAULT_MAX_ROUNDS        200
+#define BOOST_DEFAULT_MAX_DEPTH         3
+#define BOOST_DEFAULT_LEARNING_RATE     0.1f
+#define BOOST_DEFAULT_LAMBDA            1.0f
+#define BOOST_DEFAULT_MIN_CHILD_WEIGHT  1e-3f
+#define BOOST_DEFAULT_EARLY_STOPPING    10
+#define BOOST_DEFAULT_NUM_THREADS       4
+
+// Fraction of the training set held out for early stopping
+#define BOOST_VALIDATION_RATIO 0.2
+
+// Nodes with fewer samples than this build their histogram on a single thread
+#define BOOST_PARALLEL_MIN_SAMPLES 16384
+
+// Gradient boosting parameters
+// members:
+// int max_rounds: Maximum number of trees
+// int max_depth: Maximum depth of each regression tree
+// float learning_rate: Shrinkage applied to every leaf value
+// float lambda: L2 regularization on leaf values
+// float min_child_weight: Minimum hessian sum required in each child of a split
+// int early_stopping_rounds: Stop after this many rounds without validation improvement (0 disables)
+// int num_threads: Threads used to build per-node histograms (started once per boost_train call)
+// int numa: Pin the histogram threads over the NUMA nodes and place the training rows
+//           and per-sample arrays so that each thread's share is on its node (placement.h)
+typedef struct boost_params {
+    int   max_rounds;
+    int   max_depth;
+    float learning_rate;
+    float lambda;
+    float min_child_weight;
+    int   early_stopping_rounds;
+    int   num_threads;
+    int   numa;
+} boost_params;
+
+// Regression tree node (flat array representation)
+// members:
+// int attr_index: Attribute used for the split, -1 for leaves
+// int yes_child: Index of the YES child in the tree's node array
+// int no_child: Index of the NO child in the tree's node array
+// float value: Leaf output (already scaled by the learning rate)
+typedef struct boost_node {
+    int   attr_index;
+    int   yes_child;
+    int   no_child;
+    float value;
+} boost_node;
+
+typedef struct boost_tree {
+    boost_node* nodes;
+    int         num_nodes;
+} boost_tree;
+
+// Boosted ensemble for the logistic loss
+// members:
+// float base_score: Initial margin (log-odds of REPUBLICAN in the training set)
+// boost_tree* trees: Fitted trees
+// int num_trees: Number of trees kept (after early stopping)
+// int best_round: Round with the best validation loss (-1 if no validation set)
+// double best_loss: Validation log-loss at best_round
+typedef struct boost_model {
+    float       base_score;
+    boost_tree* trees;
+    int         num_trees;
+    int         best_round;
+    double      best_loss;
+} boost_model;
+
+boost_params boost_default_params();
+
+// Trains a boosted ensemble of shallow regression trees fitted to the gradients
+// and hessians of the logistic loss. Splits are found from per-node gradient
+// histograms over the binary attribute columns.
+// train_indices/valid_indices reference records; valid_indices may be NULL (no early stopping)
+boost_model* boost_train(const input_record* records,
+                         const int* train_indices, int num_train,
+                         const int* valid_indices, int num_valid,
+                         const boost_params* params);
+
+// Raw margin (log-odds of REPUBLICAN) for a record
+float boost_predict_margin(const boost_model* model, const input_record* record);
+
+// Predicted class label for a record
+int boost_predict(const boost_model* model, const input_record* record);
+
+// Accuracy of the model on a set of records
+float boost_begin_testing(const boost_model* model, const input_record* testing_set, int test_size);
+
+void boost_free_model(boost_model* model);
+
+#endif
@@ -0,0 +1,46 @@
+/*
+    Distributed training over TCP sockets.
+
+    The dataset is sharded across worker processes, each one loading its own
+    shard. The coordinator holds no records: it grows the tree level by level.
+    For every frontier node the workers send back their local count tables
+    (see ID3.h), the coordinator sums them, picks the split with the same logic
+    as ID3_train_rec and broadcasts the decisions. Workers then move each of their
+    records to its child node and count the next frontier.
+
+    The resulting tree is the one ID3_begin_training builds on the union of the
+    shards (nodes carry count tables but no sample indices).
+
+    Messages are sequences of 64-bit big-endian integers:
+        coordinator -> worker: DIST_MSG_ROUND, number of decisions, number of new frontier nodes,
+                               then per decision: split attribute (-1 for leaf), YES child id, NO child id
+        worker -> coordinator: ID3_COUNTS_SIZE counts per new frontier node
+        coordinator -> worker: DIST_MSG_DONE
+
+    Workers check every round against their current frontier (one decision per node,
+    attributes below NUM_ATTRIBUTES, child ids inside the new frontier) and fail
+    on a malformed message. Each worker streams the file and keeps only its shard.
+*/
+
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <tree.h>
+
+#define DIST_MSG_ROUND 1
+#define DIST_MSG_DONE  2
+
+// Opens a listening socket on 127.0.0.1:port (0 picks a free port, stored in bound_port)
+// Returns the socket, or -1 on error
+int dist_listen(int port, int* bound_port);
+
+// Accepts num_workers workers on listen_fd and trains the tree with them
+// Returns the root, or NULL on error
+tree_node* dist_coordinator_train(int listen_fd, int num_workers);
+
+// Worker process: loads rows shard, shard + num_shards, ... of the file at data_path,
+// connects to the coordinator at host:port and serves count requests until done
+// Returns 0 on success, -1 on error
+int dist_worker_run(const char* host, int port, const char* data_path, int shard, int num_shards);
+
+#endif
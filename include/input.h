@@ -7,13 +7,33 @@
 
     Each line contains 14 attributes followed by a class label.
     This should be the only accepted format.
+
+    Binary format (input_write_binary / input_read_binary_file), little endian:
+        header: 4-byte magic "DTRB", uint32 number of attributes, uint64 number of records
+        records: INPUT_BINARY_RECORD_SIZE bytes each, bit i set if attribute i is YES,
+                 bit NUM_ATTRIBUTES set if the label is REPUBLICAN
 */
 
 #ifndef READ_INPUT_H
 #define READ_INPUT_H
 
+#include <stdio.h>
+
 #define NUM_ATTRIBUTES 14
 
+// Dataset read by input_read() / input_get_num_records(), relative to the build directory
+#define INPUT_DEFAULT_PATH "../input.txt"
+
+#define INPUT_BINARY_MAGIC       "DTRB"
+#define INPUT_BINARY_HEADER_SIZE 16
+#define INPUT_BINARY_RECORD_SIZE ((NUM_ATTRIBUTES + 1 + 7) / 8)
+
+// Longest accepted text line, newline excluded
+#define INPUT_MAX_LINE 256
+
+// Shortest text line with a record: NUM_ATTRIBUTES "y," / "n," pairs, "democrat" and a newline
+#define INPUT_MIN_LINE (2 * NUM_ATTRIBUTES + 8 + 1)
+
 typedef enum { NO, YES } attribute_value;
 
 typedef enum { DEMOCRAT, REPUBLICAN } class_label;
@@ -27,6 +47,88 @@ int input_get_num_records();
 
 input_record* input_read();
 
+// Same as above for an arbitrary file in the input format
+int input_get_num_records_file(const char* path);
+
+// Reads all records of the file; the number of records is stored in num_records
+input_record* input_read_file(const char* path, int* num_records);
+
+typedef enum {
+    INPUT_PARSE_OK,
+    INPUT_PARSE_BLANK,              // blank line, no record
+    INPUT_PARSE_TRUNCATED,          // line ends before the class label
+    INPUT_PARSE_INVALID_ATTRIBUTE,  // attribute other than y or n
+    INPUT_PARSE_INVALID_LABEL,
+    INPUT_PARSE_TRAILING            // characters after the class label
+} input_parse_status;
+
+// Parses one text line [line, end), newline excluded (trailing '\r' and blanks allowed)
+input_parse_status input_parse_line(const char* line, const char* end, input_record* record);
+
+// Reports why the line [line, end) failed to parse, caller being the function named in the message
+void input_print_parse_error(const char* caller, input_parse_status status,
+                             const char* line, const char* end, long long lineno);
+
+// Writes records in the text input format, returns 0 on success
+int input_write_records(FILE* file, const input_record* records, int num_records);
+
+// Binary format: header (once) followed by packed records, return 0 on success
+int input_write_binary_header(FILE* file, unsigned long long num_records);
+int input_write_binary(FILE* file, const input_record* records, int num_records);
+
+// Reads a whole binary file; the number of records is stored in num_records
+input_record* input_read_binary_file(const char* path, int* num_records);
+
+// Decodes the INPUT_BINARY_HEADER_SIZE bytes of a binary header (magic included)
+// Returns its number of records, or 0 if the header is invalid or does not hold
+// 1 to INT_MAX records of NUM_ATTRIBUTES attributes (reported as an error of caller)
+unsigned long long input_decode_binary_header(const unsigned char* header, const char* caller);
+
+// Reads records shard, shard + num_shards, ... of a text or binary file (detected by
+// its magic) in one streaming pass: only the shard is held in memory
+input_record* input_read_shard(const char* path, int shard, int num_shards, int* num_records);
+
+// Packs/unpacks one record to/from INPUT_BINARY_RECORD_SIZE bytes
+void input_pack_record(const input_record* record, unsigned char* out);
+void input_unpack_record(const unsigned char* in, input_record* record);
+
+// Pre-aggregation: returns the distinct records (attributes and label) in order of
+// first occurrence; weights receives the number of occurrences of each of them
+// and num_unique their count. Caller frees both arrays.
+input_record* input_collapse_records(const input_record* records, int num_records,
+                                     int* num_unique, long long** weights);
+
+// Streaming pre-aggregation: records are added one at a time while they are read,
+// so memory grows with the number of distinct records only (see pipeline_load).
+// Records are keyed by their packed binary encoding (input_pack_record).
+// members:
+// int* slots: Open addressing table of indices into unique, -1 for an empty slot
+// int num_slots: Size of slots (power of two, load factor under 1/2)
+// unsigned long long* keys: Key of each distinct record
+// input_record* unique: Distinct records in order of first occurrence
+// long long* weights: Number of occurrences of each distinct record
+// int count: Number of distinct records
+// int capacity: Allocated size of keys, unique and weights
+typedef struct input_collapser {
+    int*                slots;
+    int                 num_slots;
+    unsigned long long* keys;
+    input_record*       unique;
+    long long*          weights;
+    int                 count;
+    int                 capacity;
+} input_collapser;
+
+input_collapser* input_collapser_create(void);
+
+// Returns 0 on success, -1 on error
+int input_collapser_add(input_collapser* collapser, const input_record* record);
+
+// Same results as input_collapse_records over the added records; frees the collapser
+input_record* input_collapser_finish(input_collapser* collapser, int* num_unique, long long** weights);
+
+void input_collapser_free(input_collapser* collapser);
+
 void input_print_records(input_record* records, int num_records);
 
 // Convert enum to string for display
@@ -0,0 +1,38 @@
+/*
+    Pipelined loading: reading, parsing, train/test assignment and root counting overlap.
+
+    The file is read in PIPELINE_BLOCK_SIZE blocks by an asynchronous reader that keeps
+    up to PIPELINE_QUEUE_DEPTH blocks in flight (io_uring when built with liburing,
+    a reader thread otherwise). The calling thread parses each block as soon as it
+    arrives, text or binary format (detected by its magic). Every record is assigned
+    to the training or testing set from a seeded hash of its position, so no shuffle
+    copy is needed afterwards. Training records are counted into the root count table
+    (see ID3.h) on the fly: when the last block is parsed the root split statistics
+    are ready for ID3_begin_training_counts.
+
+    The split is a Bernoulli draw per record: the training set holds about
+    TRAINING_SET_RATIO of the records, not exactly (int)(num_records * TRAINING_SET_RATIO).
+
+    With collapse, training records go straight into an input_collapser: the training
+    set is built from the distinct records with their weights (as after
+    ID3_collapse_training_set), and the raw training records are never held in memory.
+*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <ID3.h>
+
+#define PIPELINE_BLOCK_SIZE  (1 << 20)
+#define PIPELINE_QUEUE_DEPTH 4
+
+#define PIPELINE_DEFAULT_SEED 42
+
+// Loads the dataset at path into a new problem (root NULL, training_set_size set)
+// collapse: collapse the training records while reading (training_weights set)
+// root_counts receives the count table of the training set (caller frees, or hands it
+// to ID3_begin_training_counts) and test_size the number of testing records
+// Returns the problem, or NULL on error
+ID3_problem* pipeline_load(const char* path, unsigned long long seed, int collapse, long long** root_counts, int* test_size);
+
+#endif
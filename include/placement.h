@@ -0,0 +1,52 @@
+/*
+    NUMA-aware placement: machine topology, thread pinning and first-touch allocation.
+
+    The topology is read from sysfs (/sys/devices/system/node), restricted to the
+    CPUs the process may run on. Without NUMA information the machine is a single
+    node holding every allowed CPU.
+
+    Workers are spread round-robin over the nodes: worker w runs on node
+    w % num_nodes, on the (w / num_nodes)-th CPU of that node. Linux places a page
+    on the node of the thread that first writes it, so data a pinned worker uses
+    is allocated and first written by that worker (see placement_touch_slice).
+*/
+
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define PLACEMENT_MAX_NODES 64
+#define PLACEMENT_MAX_CPUS  1024
+
+// members:
+// int num_nodes: Number of NUMA nodes with at least one allowed CPU
+// int node_ids: sysfs id of each node
+// int node_offsets: CPUs of node n are cpus[node_offsets[n] .. node_offsets[n + 1] - 1]
+// int cpus: Allowed CPUs grouped by node
+typedef struct placement_topology {
+    int num_nodes;
+    int node_ids[PLACEMENT_MAX_NODES];
+    int node_offsets[PLACEMENT_MAX_NODES + 1];
+    int cpus[PLACEMENT_MAX_CPUS];
+} placement_topology;
+
+// Topology of the machine, detected on first use
+const placement_topology* placement_get_topology(void);
+
+// Node index (0 .. num_nodes - 1) and CPU of a worker
+int placement_worker_node(int worker);
+int placement_worker_cpu(int worker);
+
+// pthread_create with the new thread pinned to the CPU of worker from its start
+// (unpinned if the affinity cannot be set); returns 0 on success
+int placement_create_thread(pthread_t* thread, void* (*start)(void*), void* arg, int worker);
+
+// Splits a fresh allocation of size bytes into page-aligned slices, slice w to be
+// first written by worker w so that its pages land on that worker's node.
+// Returns the size of a slice, or 0 if size is too small to be split and one
+// thread writes all of it
+size_t placement_touch_slice(size_t size, int num_workers);
+
+#endif
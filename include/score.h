@@ -0,0 +1,33 @@
+/*
+    Streaming batch scoring with a trained (or loaded, see tree_load) tree.
+
+    Records are read from a stream in the text input format or in the binary format
+    (one or more concatenated header + records batches, detected by the magic) and
+    their predicted labels are written to another stream, one per line
+    ("democrat" / "republican"), in input order.
+
+    The calling thread cuts the input into chunks of whole lines or records and
+    writes the finished chunks in order; worker threads parse, classify
+    (ID3_predict_compact on a compact copy of the tree) and format whole chunks
+    into their own scratch. At most 2 chunks per worker are in memory at any time.
+*/
+
+#ifndef SCORE_H
+#define SCORE_H
+
+#include <stdio.h>
+
+#include <tree.h>
+
+// Records per chunk (binary input; text chunks hold at most about as many lines)
+#define SCORE_BATCH_RECORDS 65536
+
+#define SCORE_MAX_THREADS 64
+
+// Scores every record of in into out with num_threads workers (inline if <= 1)
+// numa: pin the workers over the NUMA nodes, with node-local scratch and one copy
+// of the tree per node (see placement.h)
+// Returns the number of records scored, or -1 on error
+long long score_stream(const tree_node* root, FILE* in, FILE* out, int num_threads, int numa);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdio.h>
+
+#include <input.h>
+
+#define SYNTH_DEFAULT_SEED            42
+#define SYNTH_DEFAULT_YES_PROBABILITY 0.5f
+#define SYNTH_DEFAULT_CLASS_BALANCE   0.5f
+#define SYNTH_DEFAULT_NOISE           0.1f
+#define SYNTH_DEFAULT_TREE_DEPTH      3
+
+// Synthetic dataset parameters
+// members:
+// unsigned long long seed: Seed of the planted tree and of every row
+// float yes_probability: Probability of each attribute being YES (attributes are binary)
+// float class_balance: Target fraction of REPUBLICAN labels; exact for tree_depth 0,
+//                      otherwise rounded to the fraction of REPUBLICAN planted leaves
+// float noise: Probability of flipping the planted label of a row
+// int tree_depth: Depth of the planted ground-truth tree (0 to NUM_ATTRIBUTES)
+typedef struct synth_params {
+    unsigned long long seed;
+    float yes_probability;
+    float class_balance;
+    float noise;
+    int   tree_depth;
+} synth_params;
+
+// Planted ground-truth tree, stored as a complete binary tree
+// members:
+// synth_params params: Generation parameters
+// int* split_attrs: Attribute of each internal node (heap layout, YES child 2k+1, NO child 2k+2)
+// int* leaf_labels: Label of each of the 2^tree_depth leaves
+typedef struct synth_generator {
+    synth_params params;
+    int*         split_attrs;
+    int*         leaf_labels;
+} synth_generator;
+
+synth_params synth_default_params();
+
+synth_generator* synth_create(const synth_params* params);
+
+void synth_free(synth_generator* generator);
+
+// Generates rows [first_row, first_row + count) into records.
+// Every row depends only on the seed and its row number, so any range can be
+// generated independently (and in parallel) with identical results.
+void synth_generate(const synth_generator* generator, unsigned long long first_row, int count, input_record* records);
+
+// Label given by the planted tree (without noise)
+int synth_planted_label(const synth_generator* generator, const input_record* record);
+
+// Prints the planted tree in the same layout as tree_print
+void synth_print_tree(const synth_generator* generator, FILE* out);
+
+#endif
@@ -0,0 +1,53 @@
+/*
+    Hot-path instrumentation.
+
+    Compiled in only when ID3_TRACE is defined (CMake option ID3_TRACE=ON);
+    otherwise TRACE_START/TRACE_STOP expand to nothing.
+
+    Each TRACE_START/TRACE_STOP pair measures one span with the CPU timestamp
+    counter and adds it to per-thread, per-phase, per-depth counters. The first
+    TRACE_MAX_EVENTS spans of every thread are also kept as events. At exit the
+    events are written as a Chrome trace-event JSON file (chrome://tracing,
+    Perfetto) to $ID3_TRACE_FILE (default TRACE_DEFAULT_FILE) and a per-depth
+    summary is printed to stderr.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#define TRACE_MAX_DEPTH    32
+#define TRACE_MAX_EVENTS   (1 << 20)
+#define TRACE_EVENT_CHUNK  4096     // events allocated at a time, up to TRACE_MAX_EVENTS
+#define TRACE_DEFAULT_FILE "decisiontree_trace.json"
+
+// Phases and the unit of their items
+typedef enum {
+    TRACE_LOAD,             // records loaded
+    TRACE_COUNT,            // samples scanned into count tables / histograms
+    TRACE_SPLIT_SEARCH,     // candidate attributes scored
+    TRACE_PARTITION,        // samples partitioned
+    TRACE_NODE_ALLOC,       // nodes allocated
+    TRACE_PREDICT,          // records classified
+    TRACE_NUM_PHASES
+} trace_phase;
+
+// Current timestamp in ticks (TSC on x86, nanoseconds elsewhere)
+unsigned long long trace_now(void);
+
+// Records a span [start, now) of the given phase at a tree depth,
+// items: number of records/samples/nodes processed by the span
+void trace_record(trace_phase phase, int depth, unsigned long long start, long long items);
+
+// Writes the trace file and the summary (registered with atexit on first use).
+// Exports once: later calls, and spans recorded afterwards, are ignored.
+void trace_export(void);
+
+#ifdef ID3_TRACE
+#define TRACE_START(name) unsigned long long name = trace_now()
+#define TRACE_STOP(name, phase, depth, items) trace_record((phase), (depth), (name), (items))
+#else
+#define TRACE_START(name) ((void)0)
+#define TRACE_STOP(name, phase, depth, items) ((void)0)
+#endif
+
+#endif
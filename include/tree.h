@@ -22,6 +22,8 @@ typedef enum {
 //   int class_label: Final classification (valid if LEAF)
 //   int* sample_indices: Array containing indices of samples reaching this node
 //   int sample_count: Number of samples
+//   int sample_capacity: Allocated size of sample_indices
+//   long long* counts: Class/attribute count table of the samples (see ID3.h), may be NULL
 typedef struct tree_node {
     int    children_count;
     int    max_children;
@@ -32,6 +34,8 @@ typedef struct tree_node {
     int       class_label;
     int*      sample_indices;
     int       sample_count;
+    int       sample_capacity;
+    long long* counts;
 } tree_node;
 
 // create leaf node
@@ -43,10 +47,25 @@ tree_node* tree_create_internal(int decision_attr_index, const int* sample_indic
 // add already created child to parent
 int tree_attach_child(tree_node* parent, tree_node* child);
 
+// append a sample index to the node, growing sample_indices as needed
+int tree_append_sample(tree_node* node, int sample_index);
+
 void tree_delete(tree_node* root);
 
 void tree_print(tree_node* root);
 
 void tree_print_rec(tree_node* node, char* prefix);
 
+// Model file (text): header "DTREE <version> <number of attributes>", then one line
+// per node in preorder: "I <attribute> <number of children>" or "L <class label>".
+// Only the structure is stored (no sample indices, no count tables).
+#define TREE_MODEL_MAGIC   "DTREE"
+#define TREE_MODEL_VERSION 1
+
+// Saves the tree to the file at path, returns 0 on success
+int tree_save(const tree_node* root, const char* path);
+
+// Loads a tree saved by tree_save, returns NULL on error
+tree_node* tree_load(const char* path);
+
 #endif
\ No newline at end of file
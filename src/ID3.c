@@ -1,6 +1,12 @@
 #include <ID3.h>
+#include <trace.h>
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
+#include <pthread.h>
+
+// Depth of a node during training: every level consumes one attribute
+#define NODE_DEPTH(num_available) (NUM_ATTRIBUTES - (num_available))
 
 ID3_problem* ID3_create_problem(tree_node* root, input_record* training_set, input_record* testing_set, int training_set_ratio) {
     ID3_problem* problem = (ID3_problem*)malloc(sizeof(ID3_problem));
@@ -11,6 +17,9 @@ ID3_problem* ID3_create_problem(tree_node* root, input_record* training_set, inp
     }
     
     problem->training_set_ratio = training_set_ratio;
+    problem->training_set_size = 0;
+    problem->training_set_capacity = 0;
+    problem->training_weights = NULL;
     problem->training_set = training_set;
     problem->testing_set  = testing_set;
     problem->root = root;
@@ -67,6 +76,10 @@ ID3_problem* ID3_generate_problem(input_record* records, int num_records) {
     free(indices);
 
     ID3_problem* problem = ID3_create_problem(NULL, training_set, testing_set, TRAINING_SET_RATIO);
+    if(problem != NULL) {
+        problem->training_set_size = train_size;
+        problem->training_set_capacity = train_size;
+    }
     return problem;
 }
 
@@ -76,19 +89,104 @@ void ID3_free_problem(ID3_problem* problem) {
 
     free(problem->training_set);
     free(problem->testing_set);
+    free(problem->training_weights);
     free(problem->root);
     free(problem);
 }
 
+// n*log2(n) table, filled once (integer-only in fixed-point mode)
+static ID3_score nlogn_table[ID3_NLOGN_TABLE_SIZE];
+static pthread_once_t nlogn_once = PTHREAD_ONCE_INIT;
+
+#ifdef ID3_FIXED_POINT
+// log2(x) in Q32 computed with integer arithmetic only (digit-by-digit squaring),
+// so that scores do not depend on the libm/compiler in use
+static unsigned long long log2_q32(unsigned long long x) {
+    int k = 63;
+    while(!(x >> k))
+        k--;
+
+    // mantissa in [1, 2) as Q62
+    unsigned long long m = k <= 62 ? x << (62 - k) : x >> (k - 62);
+    unsigned long long frac = 0;
+    for(int bit = 31; bit >= 0; bit--) {
+        m = (unsigned long long)(((unsigned __int128)m * m) >> 62);
+        if(m >= (2ULL << 62)) {
+            m >>= 1;
+            frac |= 1ULL << bit;
+        }
+    }
+
+    return ((unsigned long long)k << 32) | frac;
+}
+
+static ID3_score compute_nlogn(long long n) {
+    if(n <= 1)
+        return 0;
+    unsigned __int128 product = (unsigned __int128)n * log2_q32((unsigned long long)n);
+    return (ID3_score)(product >> (32 - ID3_FIXED_POINT_SHIFT));
+}
+
+static float score_to_float(ID3_score score) {
+    return (float)((double)score / (double)(1LL << ID3_FIXED_POINT_SHIFT));
+}
+#else
+static ID3_score compute_nlogn(long long n) {
+    if(n <= 1)
+        return 0.0;
+    return (double)n * log2((double)n);
+}
+
+static float score_to_float(ID3_score score) {
+    return (float)score;
+}
+#endif
+
+static void fill_nlogn_table(void) {
+    for(int n = 0; n < ID3_NLOGN_TABLE_SIZE; n++)
+        nlogn_table[n] = compute_nlogn(n);
+}
+
+ID3_score ID3_nlogn(long long n) {
+    pthread_once(&nlogn_once, fill_nlogn_table);
+    if(n >= 0 && n < ID3_NLOGN_TABLE_SIZE)
+        return nlogn_table[n];
+    return compute_nlogn(n);
+}
+
+// |S| * H(S) for a two-class set: n*log2(n) - sum_c c*log2(c)
+static ID3_score scaled_entropy(long long democrat_count, long long republican_count) {
+    return ID3_nlogn(democrat_count + republican_count) - ID3_nlogn(democrat_count) - ID3_nlogn(republican_count);
+}
+
+ID3_score ID3_split_score(const long long* counts, int attribute_index) {
+    return scaled_entropy(ID3_ATTR_COUNT(counts, attribute_index, YES, DEMOCRAT),
+                          ID3_ATTR_COUNT(counts, attribute_index, YES, REPUBLICAN)) +
+           scaled_entropy(ID3_ATTR_COUNT(counts, attribute_index, NO, DEMOCRAT),
+                          ID3_ATTR_COUNT(counts, attribute_index, NO, REPUBLICAN));
+}
+
+// Count table of a plain array of records
+static void count_records(const input_record* records, int num_records, long long* counts) {
+    memset(counts, 0, ID3_COUNTS_SIZE * sizeof(long long));
+
+    for(int i = 0; i < num_records; i++) {
+        ID3_CLASS_COUNT(counts, records[i].label)++;
+        for(int a = 0; a < NUM_ATTRIBUTES; a++)
+            ID3_ATTR_COUNT(counts, a, records[i].attributes[a], records[i].label)++;
+    }
+}
+
 // Calculates the entropy of a set of records
 // H(S) = -p_democrat * log2(p_democrat) - p_republican * log2(p_republican)
+//      = (|S|*log2|S| - sum_c |S_c|*log2|S_c|) / |S|
 // Returns a value between 0.0 (pure) and 1.0 (50%-50%, maximum impurity)
 float ID3_get_entropy(const input_record* records, int num_records) {
     if(num_records <= 0)
         return 0.0;
     
-    int democrat_count = 0;
-    int republican_count = 0;
+    long long democrat_count = 0;
+    long long republican_count = 0;
     
     for(int i = 0; i < num_records; i++) {
         if(records[i].label == DEMOCRAT)
@@ -97,19 +195,7 @@ float ID3_get_entropy(const input_record* records, int num_records) {
             republican_count++;
     }
     
-    // If all are in the same class, entropy = 0 (pure)
-    if(democrat_count == 0 || republican_count == 0) {
-        return 0.0;
-    }
-    
-    // Calculate proportions
-    float p_democrat = (float)democrat_count / num_records;
-    float p_republican = (float)republican_count / num_records;
-    
-    // H(S) = -p1*log2(p1) - p2*log2(p2)
-    float entropy = -(p_democrat * log2f(p_democrat)) - (p_republican * log2f(p_republican));
-    
-    return entropy;
+    return score_to_float(scaled_entropy(democrat_count, republican_count)) / num_records;
 }
 
 // Calculates the information gain for a specific attribute
@@ -119,60 +205,10 @@ float ID3_get_information_gain(const input_record* records, int num_records, int
     if(num_records <= 0 || attribute_index < 0 || attribute_index >= NUM_ATTRIBUTES)
         return 0.0;
     
-    // original entropy
-    float total_entropy = ID3_get_entropy(records, num_records);
-    
-    // Divide records by attribute value (YES or NO)
-    int yes_count = 0;
-    int no_count = 0;
-    
-    // Count how many have YES and NO for this attribute
-    for(int i = 0; i < num_records; i++) {
-        if(records[i].attributes[attribute_index] == YES)
-            yes_count++;
-        else
-            no_count++;
-    }
-    
-    // Allocate temporary subsets
-    input_record* yes_subset = (input_record*)malloc(yes_count * sizeof(input_record));
-    input_record* no_subset = (input_record*)malloc(no_count * sizeof(input_record));
-    
-    if(yes_subset == NULL || no_subset == NULL) {
-        printf("Error at ID3_get_information_gain: memory allocation failed.\n");
-        free(yes_subset);
-        free(no_subset);
-        return 0.0;
-    }
-    
-    // Preencher os subsets
-    int yes_idx = 0;
-    int no_idx = 0;
-    
-    for(int i = 0; i < num_records; i++) {
-        if(records[i].attributes[attribute_index] == YES) {
-            yes_subset[yes_idx] = records[i];
-            yes_idx++;
-        } else {
-            no_subset[no_idx] = records[i];
-            no_idx++;
-        }
-    }
-    
-    // Calculate weighted entropy of subsets
-    float yes_entropy = ID3_get_entropy(yes_subset, yes_count);
-    float no_entropy  = ID3_get_entropy(no_subset, no_count);
-    
-    float weighted_entropy = ((float)yes_count / num_records) * yes_entropy +
-                            ((float)no_count / num_records) * no_entropy;
-    
-    free(yes_subset);
-    free(no_subset);
-    
-    // Information gain = original entropy - weighted entropy
-    float information_gain = total_entropy - weighted_entropy;
+    long long counts[ID3_COUNTS_SIZE];
+    count_records(records, num_records, counts);
     
-    return information_gain;
+    return ID3_get_information_gain_counts(counts, attribute_index);
 }
 
 // Finds the best attribute (with highest information gain)
@@ -182,32 +218,92 @@ int ID3_find_best_attribute(const input_record* records, int num_records, const
         return -1;
     }
     
-    int best_attribute = -1;
-    float best_gain = -1.0;
+    long long counts[ID3_COUNTS_SIZE];
+    count_records(records, num_records, counts);
     
+    return ID3_find_best_attribute_counts(counts, available_attributes, num_available);
+}
+
+void ID3_get_counts(const input_record* training_set, const long long* weights,
+                    const int* sample_indices, int num_samples, long long* counts) {
+    memset(counts, 0, ID3_COUNTS_SIZE * sizeof(long long));
+
+    for(int i = 0; i < num_samples; i++) {
+        const input_record* record = &training_set[sample_indices[i]];
+        long long weight = weights != NULL ? weights[sample_indices[i]] : 1;
+        ID3_CLASS_COUNT(counts, record->label) += weight;
+        for(int a = 0; a < NUM_ATTRIBUTES; a++)
+            ID3_ATTR_COUNT(counts, a, record->attributes[a], record->label) += weight;
+    }
+}
+
+float ID3_get_information_gain_counts(const long long* counts, int attribute_index) {
+    if(counts == NULL || attribute_index < 0 || attribute_index >= NUM_ATTRIBUTES)
+        return 0.0;
+
+    long long num_records = ID3_CLASS_COUNT(counts, DEMOCRAT) + ID3_CLASS_COUNT(counts, REPUBLICAN);
+    if(num_records <= 0)
+        return 0.0;
+
+    // |S| * Gain = |S| * H(S) - sum_v |S_v| * H(S_v)
+    ID3_score scaled_gain = scaled_entropy(ID3_CLASS_COUNT(counts, DEMOCRAT), ID3_CLASS_COUNT(counts, REPUBLICAN)) -
+                            ID3_split_score(counts, attribute_index);
+
+    return score_to_float(scaled_gain) / num_records;
+}
+
+// The parent entropy is the same for every candidate, so the best attribute is
+// the one with the lowest split score (first one on ties)
+int ID3_find_best_attribute_counts(const long long* counts, const int* available_attributes, int num_available) {
+    if(counts == NULL || available_attributes == NULL || num_available <= 0)
+        return -1;
+
+    if(ID3_CLASS_COUNT(counts, DEMOCRAT) + ID3_CLASS_COUNT(counts, REPUBLICAN) <= 0)
+        return -1;
+
+    int best_attribute = -1;
+    ID3_score best_score = 0;
+
     for(int i = 0; i < num_available; i++) {
         int attr_idx = available_attributes[i];
-        float gain = ID3_get_information_gain(records, num_records, attr_idx);
-        
-        if(gain > best_gain) {
-            best_gain = gain;
+        ID3_score score = ID3_split_score(counts, attr_idx);
+
+        if(best_attribute < 0 || score < best_score) {
+            best_score = score;
             best_attribute = attr_idx;
         }
     }
-    
+
     return best_attribute;
 }
 
+// Recursive training on a node whose count table is already known.
+// Takes ownership of counts (kept by the created node).
+static void train_node(tree_node** node_ptr,
+                       input_record* training_set,
+                       const long long* weights,
+                       int* sample_indices,
+                       int num_samples,
+                       int* available_attributes,
+                       int num_available_attributes,
+                       long long* counts);
+
 void ID3_begin_training(ID3_problem* problem, int train_size) {
+    ID3_begin_training_counts(problem, train_size, NULL);
+}
+
+void ID3_begin_training_counts(ID3_problem* problem, int train_size, long long* root_counts) {
     if(problem == NULL) {
         printf("Error at ID3_begin_training: NULL problem pointer.\n");
+        free(root_counts);
         return;
     }
     
     // Initialize: all samples and all attributes available
-    int* root_samples = (int*)malloc(train_size * sizeof(int));
+    int* root_samples = (int*)malloc((train_size > 0 ? train_size : 1) * sizeof(int));
     if(root_samples == NULL) {
         printf("Error at ID3_begin_training: memory allocation failed.\n");
+        free(root_counts);
         return;
     }
     
@@ -219,57 +315,43 @@ void ID3_begin_training(ID3_problem* problem, int train_size) {
     if(all_attrs == NULL) {
         printf("Error at ID3_begin_training: memory allocation failed.\n");
         free(root_samples);
+        free(root_counts);
         return;
     }
     
     for(int i = 0; i < NUM_ATTRIBUTES; i++)
         all_attrs[i] = i;
     
-    // Start recursive training
-    ID3_train_rec(&(problem->root), problem->training_set, root_samples, train_size, all_attrs, NUM_ATTRIBUTES);
-    
-    free(all_attrs);
-    // root_samples ownership transferred to tree node
-}
-
-// Helper function to get majority class from sample indices
-static int get_majority_class(input_record* training_set, int* sample_indices, int num_samples) {
-    int democrat_count = 0;
-    int republican_count = 0;
-    
-    for(int i = 0; i < num_samples; i++) {
-        int idx = sample_indices[i];
-        if(training_set[idx].label == DEMOCRAT)
-            democrat_count++;
-        else
-            republican_count++;
+    // Start recursive training (the root count table is only computed when not given)
+    if(root_counts != NULL && train_size > 0)
+        train_node(&(problem->root), problem->training_set, problem->training_weights,
+                   root_samples, train_size, all_attrs, NUM_ATTRIBUTES, root_counts);
+    else {
+        free(root_counts);
+        ID3_train_rec(&(problem->root), problem->training_set, problem->training_weights,
+                      root_samples, train_size, all_attrs, NUM_ATTRIBUTES);
     }
     
-    return (democrat_count >= republican_count) ? DEMOCRAT : REPUBLICAN;
+    free(all_attrs);
+    free(root_samples);
 }
 
-// Helper function to check if all samples have same class
-static int all_same_class(input_record* training_set, int* sample_indices, int num_samples) {
-    if(num_samples == 0) return 1;
-    
-    class_label first_label = training_set[sample_indices[0]].label;
-    for(int i = 1; i < num_samples; i++) {
-        if(training_set[sample_indices[i]].label != first_label)
-            return 0;
-    }
-    return 1;
-}
+// Helper to give an empty branch a leaf with the parent's majority class,
+// so that children[0]/children[1] always are the YES/NO branches.
+// The label is derived from the parent's count table: ID3_add_record relabels
+// the leaf whenever it updates those counts.
+static void attach_empty_leaf(tree_node* parent, int majority) {
+    tree_node* leaf = tree_create_leaf(majority, NULL, 0);
+    if(leaf == NULL)
+        return;
 
-// Helper to create subset of records based on indices (for information gain calc)
-static void get_records_by_indices(input_record* training_set, int* sample_indices, 
-                                   int num_samples, input_record* output) {
-    for(int i = 0; i < num_samples; i++) {
-        output[i] = training_set[sample_indices[i]];
-    }
+    leaf->counts = (long long*)calloc(ID3_COUNTS_SIZE, sizeof(long long));
+    tree_attach_child(parent, leaf);
 }
 
 void ID3_train_rec(tree_node** node_ptr,
                    input_record* training_set,
+                   const long long* weights,
                    int* sample_indices,
                    int num_samples,
                    int* available_attributes,
@@ -278,53 +360,82 @@ void ID3_train_rec(tree_node** node_ptr,
     // no samples (shouldnt happen)
     if(num_samples == 0) {
         *node_ptr = NULL;
-        free(sample_indices);
-        return;
-    }
-    
-    // LEAF COND1: all samples are from same class
-    if(all_same_class(training_set, sample_indices, num_samples)) {
-        int label = training_set[sample_indices[0]].label;
-        *node_ptr = tree_create_leaf(label, sample_indices, num_samples);
         return;
     }
     
-    // LEAF COND2: no more attributes, create leaf with majority class
-    if(num_available_attributes == 0) {
-        int majority = get_majority_class(training_set, sample_indices, num_samples);
-        *node_ptr = tree_create_leaf(majority, sample_indices, num_samples);
-        return;
-    }
-    
-    // recursive case: find best attribute and split
-    
-    // need to extract actual records for information gain calculation
-    input_record* current_records = (input_record*)malloc(num_samples * sizeof(input_record));
-    if(current_records == NULL) {
+    // count table of the samples: drives the leaf conditions and the split search,
+    // and stays with the node (incremental updates, sibling subtraction)
+    TRACE_START(count_start);
+    long long* counts = (long long*)malloc(ID3_COUNTS_SIZE * sizeof(long long));
+    if(counts == NULL) {
         printf("Error: memory allocation failed\n");
-        free(sample_indices);
         return;
     }
-    get_records_by_indices(training_set, sample_indices, num_samples, current_records);
+    ID3_get_counts(training_set, weights, sample_indices, num_samples, counts);
+    TRACE_STOP(count_start, TRACE_COUNT, NODE_DEPTH(num_available_attributes), num_samples);
+    
+    train_node(node_ptr, training_set, weights, sample_indices, num_samples,
+               available_attributes, num_available_attributes, counts);
+}
+
+// Helper to derive a child's count table as parent - sibling
+static void subtract_counts(const long long* parent, const long long* sibling, long long* output) {
+    for(int i = 0; i < ID3_COUNTS_SIZE; i++)
+        output[i] = parent[i] - sibling[i];
+}
+
+static void train_node(tree_node** node_ptr,
+                       input_record* training_set,
+                       const long long* weights,
+                       int* sample_indices,
+                       int num_samples,
+                       int* available_attributes,
+                       int num_available_attributes,
+                       long long* counts) {
+    
+    TRACE_START(search_start);
+    long long democrat_count = ID3_CLASS_COUNT(counts, DEMOCRAT);
+    long long republican_count = ID3_CLASS_COUNT(counts, REPUBLICAN);
+    int majority = (democrat_count >= republican_count) ? DEMOCRAT : REPUBLICAN;
     
-    int best_attr = ID3_find_best_attribute(current_records, num_samples, available_attributes, num_available_attributes);
-    free(current_records);
+    // LEAF COND1: all samples are from same class
+    // LEAF COND2: no more attributes
+    // otherwise find best attribute and split
+    int best_attr = -1;
+    if(democrat_count > 0 && republican_count > 0 && num_available_attributes > 0)
+        best_attr = ID3_find_best_attribute_counts(counts, available_attributes, num_available_attributes);
+    TRACE_STOP(search_start, TRACE_SPLIT_SEARCH, NODE_DEPTH(num_available_attributes),
+               best_attr >= 0 ? num_available_attributes : 0);
     
     // LEAF COND3: no good attribute found
+    // leaf with majority class (the only class for pure sets)
     if(best_attr < 0) {
-        int majority = get_majority_class(training_set, sample_indices, num_samples);
+        TRACE_START(alloc_start);
         *node_ptr = tree_create_leaf(majority, sample_indices, num_samples);
+        TRACE_STOP(alloc_start, TRACE_NODE_ALLOC, NODE_DEPTH(num_available_attributes), 1);
+        if(*node_ptr != NULL)
+            (*node_ptr)->counts = counts;
+        else
+            free(counts);
         return;
     }
     
     // INTERNAL node creation
+    TRACE_START(alloc_start);
     *node_ptr = tree_create_internal(best_attr, sample_indices, num_samples);
+    TRACE_STOP(alloc_start, TRACE_NODE_ALLOC, NODE_DEPTH(num_available_attributes), 1);
+    if(*node_ptr == NULL) {
+        free(counts);
+        return;
+    }
+    (*node_ptr)->counts = counts;
 
     // children nodes (YES/NO) creation
 
     // dataset split for YES/NO branches
 
     // split samples by attribute value (YES/NO)
+    TRACE_START(partition_start);
     int* yes_indices = (int*)malloc(num_samples * sizeof(int));
     int* no_indices = (int*)malloc(num_samples * sizeof(int));
     
@@ -348,6 +459,32 @@ void ID3_train_rec(tree_node** node_ptr,
             no_count++;
         }
     }
+    TRACE_STOP(partition_start, TRACE_PARTITION, NODE_DEPTH(num_available_attributes), num_samples);
+    
+    // children count tables: only the smaller child is scanned,
+    // the larger one is derived from the parent's table
+    TRACE_START(count_start);
+    long long* yes_counts = (long long*)malloc(ID3_COUNTS_SIZE * sizeof(long long));
+    long long* no_counts = (long long*)malloc(ID3_COUNTS_SIZE * sizeof(long long));
+    
+    if(yes_counts == NULL || no_counts == NULL) {
+        printf("Error: memory allocation failed\n");
+        free(yes_counts);
+        free(no_counts);
+        free(yes_indices);
+        free(no_indices);
+        return;
+    }
+    
+    if(yes_count <= no_count) {
+        ID3_get_counts(training_set, weights, yes_indices, yes_count, yes_counts);
+        subtract_counts(counts, yes_counts, no_counts);
+    } else {
+        ID3_get_counts(training_set, weights, no_indices, no_count, no_counts);
+        subtract_counts(counts, no_counts, yes_counts);
+    }
+    TRACE_STOP(count_start, TRACE_COUNT, NODE_DEPTH(num_available_attributes) + 1,
+               yes_count <= no_count ? yes_count : no_count);
     
     int remaining_count = num_available_attributes - 1;
     
@@ -363,6 +500,8 @@ void ID3_train_rec(tree_node** node_ptr,
             printf("Error: memory allocation failed\n");
             free(yes_indices);
             free(no_indices);
+            free(yes_counts);
+            free(no_counts);
             return;
         }
         
@@ -374,12 +513,17 @@ void ID3_train_rec(tree_node** node_ptr,
             }
         }
         
-        ID3_train_rec(&yes_child, training_set, yes_indices, yes_count, yes_remaining_attrs, remaining_count);
+        train_node(&yes_child, training_set, weights, yes_indices, yes_count, yes_remaining_attrs, remaining_count, yes_counts);
         if(yes_child != NULL)
             tree_attach_child(*node_ptr, yes_child);
         
+        free(yes_indices);
         free(yes_remaining_attrs);
-    } else free(yes_indices);
+    } else {
+        free(yes_indices);
+        free(yes_counts);
+        attach_empty_leaf(*node_ptr, majority);
+    }
     
     // NO branch
     if(no_count > 0) {
@@ -388,6 +532,7 @@ void ID3_train_rec(tree_node** node_ptr,
         if(no_remaining_attrs == NULL) {
             printf("Error: memory allocation failed\n");
             free(no_indices);
+            free(no_counts);
             return;
         }
         
@@ -399,21 +544,184 @@ void ID3_train_rec(tree_node** node_ptr,
             }
         }
         
-        ID3_train_rec(&no_child, training_set, no_indices, no_count, no_remaining_attrs, remaining_count);
+        train_node(&no_child, training_set, weights, no_indices, no_count, no_remaining_attrs, remaining_count, no_counts);
         if(no_child != NULL)
             tree_attach_child(*node_ptr, no_child);
         
+        free(no_indices);
         free(no_remaining_attrs);
-    } else free(no_indices);
+    } else {
+        free(no_indices);
+        free(no_counts);
+        attach_empty_leaf(*node_ptr, majority);
+    }
+}
+
+// Rebuilds the subtree stored at slot from its own samples (ID5R-style restructuring,
+// limited to the subtree whose split decision changed)
+static int rebuild_subtree(tree_node** slot, ID3_problem* problem, int* available_attributes, int num_available) {
+    tree_node* old_node = *slot;
+    tree_node* new_node = NULL;
+
+    ID3_train_rec(&new_node, problem->training_set, problem->training_weights, old_node->sample_indices, old_node->sample_count,
+                  available_attributes, num_available);
+    if(new_node == NULL) {
+        printf("Error at ID3_add_record: subtree rebuild failed.\n");
+        return -1;
+    }
+
+    tree_delete(old_node);
+    *slot = new_node;
+    return 0;
+}
+
+int ID3_collapse_training_set(ID3_problem* problem) {
+    if(problem == NULL || problem->training_set == NULL) {
+        printf("Error at ID3_collapse_training_set: NULL problem pointer.\n");
+        return -1;
+    }
+    if(problem->root != NULL || problem->training_weights != NULL) {
+        printf("Error at ID3_collapse_training_set: training set already trained or collapsed.\n");
+        return -1;
+    }
+
+    int num_unique = 0;
+    long long* weights = NULL;
+    input_record* unique = input_collapse_records(problem->training_set, problem->training_set_size,
+                                                  &num_unique, &weights);
+    if(unique == NULL)
+        return -1;
+
+    free(problem->training_set);
+    problem->training_set = unique;
+    problem->training_weights = weights;
+    problem->training_set_size = num_unique;
+    problem->training_set_capacity = num_unique;
+    return 0;
+}
+
+int ID3_add_record(ID3_problem* problem, const input_record* record) {
+    if(problem == NULL || record == NULL) {
+        printf("Error at ID3_add_record: NULL pointer.\n");
+        return -1;
+    }
+
+    // Grow the training set (doubling)
+    if(problem->training_set_size == problem->training_set_capacity) {
+        int new_capacity = problem->training_set_capacity > 0 ? problem->training_set_capacity * 2 : 16;
+        input_record* new_set = (input_record*)realloc(problem->training_set, new_capacity * sizeof(input_record));
+        if(new_set == NULL) {
+            printf("Error at ID3_add_record: memory allocation failed.\n");
+            return -1;
+        }
+        problem->training_set = new_set;
+
+        // collapsed training sets: new records weigh 1
+        if(problem->training_weights != NULL) {
+            long long* new_weights = (long long*)realloc(problem->training_weights, new_capacity * sizeof(long long));
+            if(new_weights == NULL) {
+                printf("Error at ID3_add_record: memory allocation failed.\n");
+                return -1;
+            }
+            problem->training_weights = new_weights;
+        }
+        problem->training_set_capacity = new_capacity;
+    }
+
+    int sample = problem->training_set_size;
+    problem->training_set[sample] = *record;
+    if(problem->training_weights != NULL)
+        problem->training_weights[sample] = 1;
+    problem->training_set_size++;
+
+    int available[NUM_ATTRIBUTES];
+    int used[NUM_ATTRIBUTES] = {0};
+
+    // Empty tree: train a single-sample root
+    if(problem->root == NULL) {
+        int* root_samples = (int*)malloc(sizeof(int));
+        if(root_samples == NULL) {
+            printf("Error at ID3_add_record: memory allocation failed.\n");
+            return -1;
+        }
+        root_samples[0] = sample;
+        for(int i = 0; i < NUM_ATTRIBUTES; i++)
+            available[i] = i;
+        ID3_train_rec(&(problem->root), problem->training_set, problem->training_weights,
+                      root_samples, 1, available, NUM_ATTRIBUTES);
+        free(root_samples);
+        return problem->root != NULL ? 0 : -1;
+    }
+
+    tree_node** slot = &(problem->root);
+    while(*slot != NULL) {
+        tree_node* node = *slot;
+
+        int num_available = 0;
+        for(int i = 0; i < NUM_ATTRIBUTES; i++)
+            if(!used[i])
+                available[num_available++] = i;
+
+        // Update the node's samples and count table with the new record
+        if(tree_append_sample(node, sample) != 0)
+            return -1;
+        if(node->counts == NULL)
+            return rebuild_subtree(slot, problem, available, num_available);
+
+        ID3_CLASS_COUNT(node->counts, record->label)++;
+        for(int a = 0; a < NUM_ATTRIBUTES; a++)
+            ID3_ATTR_COUNT(node->counts, a, record->attributes[a], record->label)++;
+
+        long long democrat_count = ID3_CLASS_COUNT(node->counts, DEMOCRAT);
+        long long republican_count = ID3_CLASS_COUNT(node->counts, REPUBLICAN);
+
+        if(node->kind == NODE_LEAF) {
+            // Still pure: same leaf
+            if(democrat_count == 0 || republican_count == 0) {
+                node->class_label = record->label;
+                return 0;
+            }
+            // No attribute left to split on: majority leaf
+            if(num_available == 0) {
+                node->class_label = (democrat_count >= republican_count) ? DEMOCRAT : REPUBLICAN;
+                return 0;
+            }
+            // Leaf became impure: expand it
+            return rebuild_subtree(slot, problem, available, num_available);
+        }
+
+        // Internal node: keep descending only while the best split is unchanged
+        int best_attr = ID3_find_best_attribute_counts(node->counts, available, num_available);
+        if(best_attr != node->decision_attr_index || node->children_count < 2)
+            return rebuild_subtree(slot, problem, available, num_available);
+
+        // Empty branches hold the parent's majority class (see attach_empty_leaf),
+        // which the new record may have flipped
+        int majority = (democrat_count >= republican_count) ? DEMOCRAT : REPUBLICAN;
+        for(int c = 0; c < node->children_count; c++) {
+            tree_node* child = node->children[c];
+            if(child != NULL && child->kind == NODE_LEAF && child->sample_count == 0)
+                child->class_label = majority;
+        }
+
+        used[best_attr] = 1;
+        // children[0] = YES branch, children[1] = NO branch
+        slot = &(node->children[record->attributes[best_attr] == YES ? 0 : 1]);
+    }
+
+    printf("Error at ID3_add_record: missing child node.\n");
+    return -1;
 }
 
 float ID3_begin_testing(ID3_problem* problem, int test_size) {
+    TRACE_START(predict_start);
     int correct_count = 0;
     for(int i = 0; i < test_size; i++) {
         int label = ID3_test_case(problem->root, &problem->testing_set[i]);
         if(label == problem->testing_set[i].label)
             correct_count++;
     }
+    TRACE_STOP(predict_start, TRACE_PREDICT, 0, test_size);
     return (float)correct_count/test_size;
 }
 
@@ -452,3 +760,142 @@ int ID3_test_case(tree_node* node, input_record* record) {
     
     return ID3_test_case(next_node, record);
 }
+
+void ID3_predict_batch(const tree_node* root, const input_record* records, int num_records, int* labels) {
+    TRACE_START(predict_start);
+    for(int i = 0; i < num_records; i++) {
+        const tree_node* node = root;
+        int label = DEMOCRAT;
+
+        while(node != NULL) {
+            if(node->kind == NODE_LEAF) {
+                label = node->class_label;
+                break;
+            }
+            // children[0] = YES branch, children[1] = NO branch
+            int branch = records[i].attributes[node->decision_attr_index] == YES ? 0 : 1;
+            node = branch < node->children_count ? node->children[branch] : NULL;
+        }
+
+        labels[i] = label;
+    }
+    TRACE_STOP(predict_start, TRACE_PREDICT, 0, num_records);
+}
+
+ID3_compact_tree* ID3_compact_tree_create(const tree_node* root) {
+    ID3_compact_tree* tree = (ID3_compact_tree*)calloc(1, sizeof(ID3_compact_tree));
+    if(tree == NULL) {
+        printf("Error at ID3_compact_tree_create: memory allocation failed.\n");
+        return NULL;
+    }
+
+    // breadth-first: source[i] is the node copied into nodes[i] (NULL for a missing child)
+    int capacity = 64;
+    const tree_node** source = (const tree_node**)malloc(capacity * sizeof(tree_node*));
+    int* depths = (int*)malloc(capacity * sizeof(int));
+    tree->nodes = (ID3_compact_node*)malloc(capacity * sizeof(ID3_compact_node));
+    if(source == NULL || depths == NULL || tree->nodes == NULL) {
+        printf("Error at ID3_compact_tree_create: memory allocation failed.\n");
+        free(source);
+        free(depths);
+        ID3_compact_tree_free(tree);
+        return NULL;
+    }
+
+    source[0] = root;
+    depths[0] = 0;
+    tree->num_nodes = 1;
+
+    for(int i = 0; i < tree->num_nodes; i++) {
+        const tree_node* node = source[i];
+        ID3_compact_node* compact = &tree->nodes[i];
+
+        if(node == NULL || node->kind == NODE_LEAF) {
+            compact->attr_index = 0;
+            compact->children[0] = compact->children[1] = i;
+            compact->class_label = node != NULL ? node->class_label : DEMOCRAT;
+            if(depths[i] > tree->depth)
+                tree->depth = depths[i];
+            continue;
+        }
+
+        if(tree->num_nodes + 2 > capacity) {
+            capacity *= 2;
+            const tree_node** new_source = (const tree_node**)realloc(source, capacity * sizeof(tree_node*));
+            if(new_source != NULL)
+                source = new_source;
+            int* new_depths = (int*)realloc(depths, capacity * sizeof(int));
+            if(new_depths != NULL)
+                depths = new_depths;
+            ID3_compact_node* new_nodes = (ID3_compact_node*)realloc(tree->nodes, capacity * sizeof(ID3_compact_node));
+            if(new_nodes != NULL)
+                tree->nodes = new_nodes;
+            if(new_source == NULL || new_depths == NULL || new_nodes == NULL) {
+                printf("Error at ID3_compact_tree_create: memory allocation failed.\n");
+                free(source);
+                free(depths);
+                ID3_compact_tree_free(tree);
+                return NULL;
+            }
+            compact = &tree->nodes[i];
+        }
+
+        compact->attr_index = node->decision_attr_index;
+        compact->class_label = DEMOCRAT;
+        // children[0] = YES branch, children[1] = NO branch
+        for(int branch = 0; branch < 2; branch++) {
+            int child = tree->num_nodes++;
+            source[child] = branch < node->children_count ? node->children[branch] : NULL;
+            depths[child] = depths[i] + 1;
+            compact->children[branch] = child;
+        }
+    }
+
+    free(source);
+    free(depths);
+    return tree;
+}
+
+ID3_compact_tree* ID3_compact_tree_clone(const ID3_compact_tree* tree) {
+    ID3_compact_tree* copy = (ID3_compact_tree*)malloc(sizeof(ID3_compact_tree));
+    if(copy == NULL)
+        return NULL;
+
+    *copy = *tree;
+    copy->nodes = (ID3_compact_node*)malloc(tree->num_nodes * sizeof(ID3_compact_node));
+    if(copy->nodes == NULL) {
+        free(copy);
+        return NULL;
+    }
+    memcpy(copy->nodes, tree->nodes, tree->num_nodes * sizeof(ID3_compact_node));
+    return copy;
+}
+
+void ID3_compact_tree_free(ID3_compact_tree* tree) {
+    if(tree == NULL)
+        return;
+    free(tree->nodes);
+    free(tree);
+}
+
+void ID3_predict_compact(const ID3_compact_tree* tree, const input_record* records, int num_records, int* labels) {
+    TRACE_START(predict_start);
+    const ID3_compact_node* nodes = tree->nodes;
+
+    for(int i = 0; i < num_records; i += ID3_COMPACT_GROUP) {
+        int group = num_records - i < ID3_COMPACT_GROUP ? num_records - i : ID3_COMPACT_GROUP;
+        int current[ID3_COMPACT_GROUP] = { 0 };
+
+        // independent walks: the loads of one step do not wait for each other
+        for(int step = 0; step < tree->depth; step++) {
+            for(int j = 0; j < group; j++) {
+                const ID3_compact_node* node = &nodes[current[j]];
+                current[j] = node->children[records[i + j].attributes[node->attr_index] == YES ? 0 : 1];
+            }
+        }
+
+        for(int j = 0; j < group; j++)
+            labels[i + j] = nodes[current[j]].class_label;
+    }
+    TRACE_STOP(predict_start, TRACE_PREDICT, 0, num_records);
+}
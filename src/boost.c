@@ -0,0 +1,565 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include <boost.h>
+#include <placement.h>
+#include <trace.h>
+
+// Gradient/hessian histogram of a node over the binary attribute columns
+// Only the YES bin is accumulated; the NO bin is derived as total - YES
+typedef struct boost_histogram {
+    double grad_yes[NUM_ATTRIBUTES];
+    double hess_yes[NUM_ATTRIBUTES];
+    double grad_total;
+    double hess_total;
+} boost_histogram;
+
+struct histogram_pool;
+
+// Training state shared by all the trees of one boost_train call
+typedef struct boost_context {
+    const input_record*    records;
+    const int*             train_indices;
+    const float*           grad;
+    const float*           hess;
+    const boost_params*    params;
+    struct histogram_pool* pool;   // NULL: histograms are built on the calling thread
+} boost_context;
+
+// Slice of a node's samples handled by one histogram thread
+// (or slice of a fresh allocation it first touches, see boost_alloc)
+typedef struct histogram_job {
+    struct histogram_pool* pool;
+    const int*             positions;
+    int                    count;
+    boost_histogram        hist;
+    char*                  touch_begin;
+    size_t                 touch_size;
+} histogram_job;
+
+// Histogram threads started once per boost_train call: build_histogram hands
+// them one slice each and waits until they are all done
+// members:
+// const boost_context* ctx: Training state the slices are read from
+// pthread_t* threads, int* started: Thread t (started[t] = 0 if its creation failed)
+// histogram_job* jobs: Job t is computed by thread t, or by the caller if it did not start
+// int num_threads: Number of slices per histogram
+// long long generation: Incremented for every histogram to build
+// int pending: Started threads still working on the current histogram
+// int touching: The current jobs are first touch slices instead of histograms
+// int stop: Set to make the threads exit
+typedef struct histogram_pool {
+    const boost_context* ctx;
+    pthread_t*           threads;
+    int*                 started;
+    histogram_job*       jobs;
+    int                  num_threads;
+    long long            generation;
+    int                  pending;
+    int                  touching;
+    int                  stop;
+    pthread_mutex_t      lock;
+    pthread_cond_t       cond;
+} histogram_pool;
+
+boost_params boost_default_params() {
+    boost_params params;
+    params.max_rounds = BOOST_DEFAULT_MAX_ROUNDS;
+    params.max_depth = BOOST_DEFAULT_MAX_DEPTH;
+    params.learning_rate = BOOST_DEFAULT_LEARNING_RATE;
+    params.lambda = BOOST_DEFAULT_LAMBDA;
+    params.min_child_weight = BOOST_DEFAULT_MIN_CHILD_WEIGHT;
+    params.early_stopping_rounds = BOOST_DEFAULT_EARLY_STOPPING;
+    params.num_threads = BOOST_DEFAULT_NUM_THREADS;
+    params.numa = 0;
+    return params;
+}
+
+static void accumulate_histogram(const boost_context* ctx, const int* positions, int count, boost_histogram* hist) {
+    memset(hist, 0, sizeof(boost_histogram));
+
+    for(int i = 0; i < count; i++) {
+        int p = positions[i];
+        const input_record* record = &ctx->records[ctx->train_indices[p]];
+        double g = ctx->grad[p];
+        double h = ctx->hess[p];
+
+        hist->grad_total += g;
+        hist->hess_total += h;
+        for(int a = 0; a < NUM_ATTRIBUTES; a++) {
+            if(record->attributes[a] == YES) {
+                hist->grad_yes[a] += g;
+                hist->hess_yes[a] += h;
+            }
+        }
+    }
+}
+
+static void run_job(histogram_job* job) {
+    if(job->pool->touching) {
+        memset(job->touch_begin, 0, job->touch_size);
+        return;
+    }
+
+    // accumulated on this thread's stack: neighbouring jobs share cache lines
+    boost_histogram hist;
+    accumulate_histogram(job->pool->ctx, job->positions, job->count, &hist);
+    job->hist = hist;
+}
+
+static void* histogram_worker(void* arg) {
+    histogram_job* job = (histogram_job*)arg;
+    histogram_pool* pool = job->pool;
+    long long done = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for(;;) {
+        while(!pool->stop && pool->generation == done)
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        if(pool->stop)
+            break;
+        done = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_job(job);
+
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->pending == 0)
+            pthread_cond_broadcast(&pool->cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void histogram_pool_free(histogram_pool* pool) {
+    if(pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(int t = 0; t < pool->num_threads; t++)
+        if(pool->started[t])
+            pthread_join(pool->threads[t], NULL);
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->started);
+    free(pool->jobs);
+    free(pool);
+}
+
+// Starts the histogram threads of a boost_train call (pinned with ctx->params->numa)
+// Returns NULL if they cannot be allocated: histograms are then built on the calling thread
+static histogram_pool* histogram_pool_create(const boost_context* ctx) {
+    int num_threads = ctx->params->num_threads;
+    histogram_pool* pool = (histogram_pool*)calloc(1, sizeof(histogram_pool));
+    if(pool == NULL)
+        return NULL;
+
+    pool->ctx = ctx;
+    pool->threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    pool->started = (int*)calloc(num_threads, sizeof(int));
+    pool->jobs = (histogram_job*)calloc(num_threads, sizeof(histogram_job));
+    if(pool->threads == NULL || pool->started == NULL || pool->jobs == NULL) {
+        free(pool->threads);
+        free(pool->started);
+        free(pool->jobs);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    pool->num_threads = num_threads;
+
+    // thread creation failure: build_histogram computes the slice on the calling thread instead
+    for(int t = 0; t < num_threads; t++) {
+        pool->jobs[t].pool = pool;
+        if(ctx->params->numa)
+            pool->started[t] = placement_create_thread(&pool->threads[t], histogram_worker, &pool->jobs[t], t) == 0;
+        else
+            pool->started[t] = pthread_create(&pool->threads[t], NULL, histogram_worker, &pool->jobs[t]) == 0;
+    }
+
+    return pool;
+}
+
+// Runs the jobs set up by the caller on the pool's threads and waits for all of them
+static void pool_run(histogram_pool* pool, int touching) {
+    int num_started = 0;
+    for(int t = 0; t < pool->num_threads; t++)
+        num_started += pool->started[t];
+
+    pthread_mutex_lock(&pool->lock);
+    pool->touching = touching;
+    pool->pending = num_started;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(int t = 0; t < pool->num_threads; t++)
+        if(!pool->started[t])
+            run_job(&pool->jobs[t]);
+
+    pthread_mutex_lock(&pool->lock);
+    while(pool->pending > 0)
+        pthread_cond_wait(&pool->cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Builds the histogram of a node, splitting large nodes across the pool's threads.
+// Partial histograms are reduced in thread order so results do not depend on scheduling.
+static void build_histogram(const boost_context* ctx, const int* positions, int count, boost_histogram* out) {
+    histogram_pool* pool = ctx->pool;
+    if(pool == NULL || count < BOOST_PARALLEL_MIN_SAMPLES) {
+        accumulate_histogram(ctx, positions, count, out);
+        return;
+    }
+
+    int num_threads = pool->num_threads;
+    int chunk = (count + num_threads - 1) / num_threads;
+    for(int t = 0; t < num_threads; t++) {
+        int begin = t * chunk < count ? t * chunk : count;
+        int end = begin + chunk < count ? begin + chunk : count;
+        pool->jobs[t].positions = positions + begin;
+        pool->jobs[t].count = end - begin;
+    }
+    pool_run(pool, 0);
+
+    memset(out, 0, sizeof(boost_histogram));
+    for(int t = 0; t < num_threads; t++) {
+        const boost_histogram* hist = &pool->jobs[t].hist;
+        out->grad_total += hist->grad_total;
+        out->hess_total += hist->hess_total;
+        for(int a = 0; a < NUM_ATTRIBUTES; a++) {
+            out->grad_yes[a] += hist->grad_yes[a];
+            out->hess_yes[a] += hist->hess_yes[a];
+        }
+    }
+}
+
+// Appends an empty leaf to the tree, returns its index or -1
+static int tree_new_node(boost_tree* tree, int* capacity) {
+    if(tree->num_nodes == *capacity) {
+        int new_capacity = *capacity > 0 ? *capacity * 2 : 8;
+        boost_node* new_nodes = (boost_node*)realloc(tree->nodes, new_capacity * sizeof(boost_node));
+        if(new_nodes == NULL) {
+            printf("Error at boost_train: memory allocation failed.\n");
+            return -1;
+        }
+        tree->nodes = new_nodes;
+        *capacity = new_capacity;
+    }
+
+    boost_node* node = &tree->nodes[tree->num_nodes];
+    node->attr_index = -1;
+    node->yes_child = -1;
+    node->no_child = -1;
+    node->value = 0.0f;
+    return tree->num_nodes++;
+}
+
+// Recursively grows a regression tree over positions[0..count)
+// Returns the index of the created node, or -1 on error
+static int grow_node(const boost_context* ctx, boost_tree* tree, int* capacity,
+                     int* positions, int count, int depth) {
+    const boost_params* params = ctx->params;
+
+    TRACE_START(count_start);
+    boost_histogram hist;
+    build_histogram(ctx, positions, count, &hist);
+    TRACE_STOP(count_start, TRACE_COUNT, depth, count);
+
+    TRACE_START(alloc_start);
+    int node = tree_new_node(tree, capacity);
+    TRACE_STOP(alloc_start, TRACE_NODE_ALLOC, depth, 1);
+    if(node < 0)
+        return -1;
+
+    double lambda = params->lambda;
+    tree->nodes[node].value = (float)(-hist.grad_total / (hist.hess_total + lambda) * params->learning_rate);
+
+    if(depth >= params->max_depth || count < 2)
+        return node;
+
+    // Best split: maximizes the second-order loss reduction
+    TRACE_START(search_start);
+    double parent_score = hist.grad_total * hist.grad_total / (hist.hess_total + lambda);
+    double best_gain = 0.0;
+    int best_attr = -1;
+
+    for(int a = 0; a < NUM_ATTRIBUTES; a++) {
+        double grad_yes = hist.grad_yes[a];
+        double hess_yes = hist.hess_yes[a];
+        double grad_no = hist.grad_total - grad_yes;
+        double hess_no = hist.hess_total - hess_yes;
+
+        if(hess_yes < params->min_child_weight || hess_no < params->min_child_weight)
+            continue;
+
+        double gain = grad_yes * grad_yes / (hess_yes + lambda) +
+                      grad_no * grad_no / (hess_no + lambda) - parent_score;
+
+        if(gain > best_gain) {
+            best_gain = gain;
+            best_attr = a;
+        }
+    }
+
+    TRACE_STOP(search_start, TRACE_SPLIT_SEARCH, depth, NUM_ATTRIBUTES);
+
+    // LEAF: no split reduces the loss
+    if(best_attr < 0)
+        return node;
+
+    // in-place partition: YES samples first, NO samples after
+    TRACE_START(partition_start);
+    int i = 0, j = count - 1;
+    while(i <= j) {
+        if(ctx->records[ctx->train_indices[positions[i]]].attributes[best_attr] == YES) {
+            i++;
+        } else {
+            int tmp = positions[i];
+            positions[i] = positions[j];
+            positions[j] = tmp;
+            j--;
+        }
+    }
+    int yes_count = i;
+    TRACE_STOP(partition_start, TRACE_PARTITION, depth, count);
+
+    int yes_child = grow_node(ctx, tree, capacity, positions, yes_count, depth + 1);
+    int no_child = grow_node(ctx, tree, capacity, positions + yes_count, count - yes_count, depth + 1);
+    if(yes_child < 0 || no_child < 0)
+        return -1;
+
+    // tree->nodes may have been reallocated by the recursive calls
+    tree->nodes[node].attr_index = best_attr;
+    tree->nodes[node].yes_child = yes_child;
+    tree->nodes[node].no_child = no_child;
+    return node;
+}
+
+static float tree_predict(const boost_tree* tree, const input_record* record) {
+    int node = 0;
+    while(tree->nodes[node].attr_index >= 0) {
+        const boost_node* current = &tree->nodes[node];
+        node = record->attributes[current->attr_index] == YES ? current->yes_child : current->no_child;
+    }
+    return tree->nodes[node].value;
+}
+
+static double sigmoid(double margin) {
+    return 1.0 / (1.0 + exp(-margin));
+}
+
+// Mean logistic loss of the given margins
+static double log_loss(const input_record* records, const int* indices, const float* margins, int count) {
+    const double eps = 1e-15;
+    double loss = 0.0;
+
+    for(int i = 0; i < count; i++) {
+        double p = sigmoid(margins[i]);
+        if(p < eps) p = eps;
+        if(p > 1.0 - eps) p = 1.0 - eps;
+        loss -= records[indices[i]].label == REPUBLICAN ? log(p) : log(1.0 - p);
+    }
+
+    return count > 0 ? loss / count : 0.0;
+}
+
+// Allocation of a per-sample array: with params->numa its pages are first touched by
+// the pinned histogram threads, each one writing the slice it reads at the root
+static void* boost_alloc(size_t size, histogram_pool* pool) {
+    void* data = malloc(size > 0 ? size : 1);
+    if(data == NULL || pool == NULL || !pool->ctx->params->numa)
+        return data;
+
+    size_t slice = placement_touch_slice(size, pool->num_threads);
+    if(slice == 0) {
+        memset(data, 0, size);
+        return data;
+    }
+
+    for(int t = 0; t < pool->num_threads; t++) {
+        size_t begin = (size_t)t * slice < size ? (size_t)t * slice : size;
+        size_t end = begin + slice < size ? begin + slice : size;
+        pool->jobs[t].touch_begin = (char*)data + begin;
+        pool->jobs[t].touch_size = end - begin;
+    }
+    pool_run(pool, 1);
+    return data;
+}
+
+boost_model* boost_train(const input_record* records,
+                         const int* train_indices, int num_train,
+                         const int* valid_indices, int num_valid,
+                         const boost_params* params) {
+    if(records == NULL || train_indices == NULL || num_train <= 0 || params == NULL) {
+        printf("Error at boost_train: invalid arguments.\n");
+        return NULL;
+    }
+    if(valid_indices == NULL)
+        num_valid = 0;
+
+    boost_context ctx;
+    ctx.records = records;
+    ctx.train_indices = train_indices;
+    ctx.params = params;
+    ctx.pool = NULL;
+
+    // the same threads first touch the per-sample arrays and build every large histogram of every round
+    if(params->num_threads > 1 && num_train >= BOOST_PARALLEL_MIN_SAMPLES)
+        ctx.pool = histogram_pool_create(&ctx);
+
+    boost_model* model = (boost_model*)malloc(sizeof(boost_model));
+    boost_tree* trees = (boost_tree*)calloc(params->max_rounds > 0 ? params->max_rounds : 1, sizeof(boost_tree));
+    float* grad = (float*)boost_alloc(num_train * sizeof(float), ctx.pool);
+    float* hess = (float*)boost_alloc(num_train * sizeof(float), ctx.pool);
+    float* train_margin = (float*)boost_alloc(num_train * sizeof(float), ctx.pool);
+    float* valid_margin = (float*)malloc((num_valid > 0 ? num_valid : 1) * sizeof(float));
+    int* positions = (int*)boost_alloc(num_train * sizeof(int), ctx.pool);
+
+    // NUMA: node-local copy of the training rows, in train_indices order
+    input_record* local_records = NULL;
+    int* local_indices = NULL;
+    if(params->numa) {
+        local_records = (input_record*)boost_alloc(num_train * sizeof(input_record), ctx.pool);
+        local_indices = (int*)boost_alloc(num_train * sizeof(int), ctx.pool);
+    }
+
+    if(model == NULL || trees == NULL || grad == NULL || hess == NULL || train_margin == NULL || valid_margin == NULL || positions == NULL ||
+       (params->numa && (local_records == NULL || local_indices == NULL))) {
+        printf("Error at boost_train: memory allocation failed.\n");
+        free(model); free(trees); free(grad); free(hess); free(train_margin); free(valid_margin); free(positions);
+        free(local_records); free(local_indices);
+        histogram_pool_free(ctx.pool);
+        return NULL;
+    }
+
+    ctx.grad = grad;
+    ctx.hess = hess;
+
+    if(params->numa) {
+        for(int i = 0; i < num_train; i++) {
+            local_records[i] = records[train_indices[i]];
+            local_indices[i] = i;
+        }
+        ctx.records = local_records;
+        ctx.train_indices = local_indices;
+    }
+
+    model->trees = trees;
+    model->num_trees = 0;
+    model->best_round = -1;
+    model->best_loss = INFINITY;
+
+    // base score: log-odds of the positive (REPUBLICAN) class, clamped away from 0/1
+    int positives = 0;
+    for(int i = 0; i < num_train; i++)
+        if(ctx.records[ctx.train_indices[i]].label == REPUBLICAN)
+            positives++;
+    double prior = (positives + 0.5) / (num_train + 1.0);
+    model->base_score = (float)log(prior / (1.0 - prior));
+
+    for(int i = 0; i < num_train; i++)
+        train_margin[i] = model->base_score;
+    for(int i = 0; i < num_valid; i++)
+        valid_margin[i] = model->base_score;
+
+    for(int round = 0; round < params->max_rounds; round++) {
+        // logistic loss gradients/hessians w.r.t. the margin
+        for(int i = 0; i < num_train; i++) {
+            double p = sigmoid(train_margin[i]);
+            double y = ctx.records[ctx.train_indices[i]].label == REPUBLICAN ? 1.0 : 0.0;
+            grad[i] = (float)(p - y);
+            hess[i] = (float)(p * (1.0 - p));
+            positions[i] = i;
+        }
+
+        boost_tree* tree = &model->trees[round];
+        int capacity = 0;
+        if(grow_node(&ctx, tree, &capacity, positions, num_train, 0) < 0) {
+            free(tree->nodes);
+            break;
+        }
+        model->num_trees++;
+
+        for(int i = 0; i < num_train; i++)
+            train_margin[i] += tree_predict(tree, &ctx.records[ctx.train_indices[i]]);
+
+        if(num_valid == 0)
+            continue;
+
+        // early stopping on the held-out index set
+        for(int i = 0; i < num_valid; i++)
+            valid_margin[i] += tree_predict(tree, &records[valid_indices[i]]);
+
+        double loss = log_loss(records, valid_indices, valid_margin, num_valid);
+        if(loss < model->best_loss) {
+            model->best_loss = loss;
+            model->best_round = round;
+        } else if(params->early_stopping_rounds > 0 && round - model->best_round >= params->early_stopping_rounds) {
+            break;
+        }
+    }
+
+    // keep only the trees up to the best validation round
+    if(model->best_round >= 0) {
+        for(int t = model->best_round + 1; t < model->num_trees; t++)
+            free(model->trees[t].nodes);
+        model->num_trees = model->best_round + 1;
+    }
+
+    histogram_pool_free(ctx.pool);
+    free(grad);
+    free(hess);
+    free(train_margin);
+    free(valid_margin);
+    free(positions);
+    free(local_records);
+    free(local_indices);
+    return model;
+}
+
+float boost_predict_margin(const boost_model* model, const input_record* record) {
+    float margin = model->base_score;
+    for(int t = 0; t < model->num_trees; t++)
+        margin += tree_predict(&model->trees[t], record);
+    return margin;
+}
+
+int boost_predict(const boost_model* model, const input_record* record) {
+    return boost_predict_margin(model, record) > 0.0f ? REPUBLICAN : DEMOCRAT;
+}
+
+float boost_begin_testing(const boost_model* model, const input_record* testing_set, int test_size) {
+    if(model == NULL || test_size <= 0)
+        return 0.0f;
+
+    TRACE_START(predict_start);
+    int correct_count = 0;
+    for(int i = 0; i < test_size; i++) {
+        if(boost_predict(model, &testing_set[i]) == (int)testing_set[i].label)
+            correct_count++;
+    }
+    TRACE_STOP(predict_start, TRACE_PREDICT, 0, test_size);
+    return (float)correct_count / test_size;
+}
+
+void boost_free_model(boost_model* model) {
+    if(model == NULL)
+        return;
+
+    for(int t = 0; t < model->num_trees; t++)
+        free(model->trees[t].nodes);
+    free(model->trees);
+    free(model);
+}
@@ -0,0 +1,483 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <distributed.h>
+#include <ID3.h>
+
+// Seconds a worker keeps retrying to reach the coordinator
+#define DIST_CONNECT_RETRIES 50
+
+// Node of the coordinator's frontier (next level to be decided)
+// members:
+// tree_node* parent: Node the decided node is attached to (NULL for the root)
+// unsigned used_attrs: Bit mask of the attributes used on the path from the root
+// int parent_majority: Majority class of the parent (label of empty branches)
+typedef struct dist_frontier_node {
+    tree_node* parent;
+    unsigned   used_attrs;
+    int        parent_majority;
+} dist_frontier_node;
+
+// Split decision broadcast to the workers for one frontier node
+typedef struct dist_decision {
+    long long attr_index;
+    long long yes_child;
+    long long no_child;
+} dist_decision;
+
+static int send_all(int fd, const void* data, size_t size) {
+    const char* p = (const char*)data;
+    while(size > 0) {
+        ssize_t sent = send(fd, p, size, 0);
+        if(sent < 0 && errno == EINTR)
+            continue;
+        if(sent <= 0)
+            return -1;
+        p += sent;
+        size -= (size_t)sent;
+    }
+    return 0;
+}
+
+static int recv_all(int fd, void* data, size_t size) {
+    char* p = (char*)data;
+    while(size > 0) {
+        ssize_t received = recv(fd, p, size, 0);
+        if(received < 0 && errno == EINTR)
+            continue;
+        if(received <= 0)
+            return -1;
+        p += received;
+        size -= (size_t)received;
+    }
+    return 0;
+}
+
+// 64-bit integers travel big-endian
+static void encode_values(const long long* values, int count, unsigned char* out) {
+    for(int i = 0; i < count; i++) {
+        unsigned long long v = (unsigned long long)values[i];
+        for(int b = 0; b < 8; b++)
+            out[8 * i + b] = (unsigned char)(v >> (56 - 8 * b));
+    }
+}
+
+static void decode_values(const unsigned char* in, int count, long long* values) {
+    for(int i = 0; i < count; i++) {
+        unsigned long long v = 0;
+        for(int b = 0; b < 8; b++)
+            v = (v << 8) | in[8 * i + b];
+        values[i] = (long long)v;
+    }
+}
+
+static int send_values(int fd, const long long* values, int count) {
+    if(count == 0)
+        return 0;
+
+    unsigned char* buffer = (unsigned char*)malloc((size_t)count * 8);
+    if(buffer == NULL)
+        return -1;
+
+    encode_values(values, count, buffer);
+    int status = send_all(fd, buffer, (size_t)count * 8);
+    free(buffer);
+    return status;
+}
+
+static int recv_values(int fd, long long* values, int count) {
+    if(count == 0)
+        return 0;
+
+    unsigned char* buffer = (unsigned char*)malloc((size_t)count * 8);
+    if(buffer == NULL)
+        return -1;
+
+    int status = recv_all(fd, buffer, (size_t)count * 8);
+    if(status == 0)
+        decode_values(buffer, count, values);
+    free(buffer);
+    return status;
+}
+
+int dist_listen(int port, int* bound_port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0) {
+        perror("Error at dist_listen: socket");
+        return -1;
+    }
+
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((unsigned short)port);
+
+    if(bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 64) != 0) {
+        perror("Error at dist_listen: bind/listen");
+        close(fd);
+        return -1;
+    }
+
+    socklen_t length = sizeof(address);
+    if(bound_port != NULL && getsockname(fd, (struct sockaddr*)&address, &length) == 0)
+        *bound_port = ntohs(address.sin_port);
+
+    return fd;
+}
+
+// Sends a round message to every worker and sums their count tables into counts
+static int run_round(const int* workers, int num_workers, const dist_decision* decisions, int num_decisions,
+                     int num_frontier, long long* counts) {
+    int header_size = 3 + 3 * num_decisions;
+    long long* message = (long long*)malloc(header_size * sizeof(long long));
+    long long* worker_counts = (long long*)malloc((size_t)num_frontier * ID3_COUNTS_SIZE * sizeof(long long));
+    if(message == NULL || worker_counts == NULL) {
+        printf("Error at dist_coordinator_train: memory allocation failed.\n");
+        free(message);
+        free(worker_counts);
+        return -1;
+    }
+
+    message[0] = DIST_MSG_ROUND;
+    message[1] = num_decisions;
+    message[2] = num_frontier;
+    for(int i = 0; i < num_decisions; i++) {
+        message[3 + 3 * i] = decisions[i].attr_index;
+        message[4 + 3 * i] = decisions[i].yes_child;
+        message[5 + 3 * i] = decisions[i].no_child;
+    }
+
+    int status = 0;
+
+    // broadcast first so that all workers count in parallel
+    for(int w = 0; w < num_workers && status == 0; w++)
+        status = send_values(workers[w], message, header_size);
+
+    memset(counts, 0, (size_t)num_frontier * ID3_COUNTS_SIZE * sizeof(long long));
+    for(int w = 0; w < num_workers && status == 0; w++) {
+        status = recv_values(workers[w], worker_counts, num_frontier * ID3_COUNTS_SIZE);
+        for(long long i = 0; status == 0 && i < (long long)num_frontier * ID3_COUNTS_SIZE; i++)
+            counts[i] += worker_counts[i];
+    }
+
+    if(status != 0)
+        printf("Error at dist_coordinator_train: lost connection to a worker.\n");
+
+    free(message);
+    free(worker_counts);
+    return status;
+}
+
+// Creates the node decided for a frontier entry and attaches it to its parent
+static tree_node* create_decided_node(tree_node** root, const dist_frontier_node* entry,
+                                      int best_attr, int label, const long long* counts) {
+    tree_node* node = best_attr >= 0 ? tree_create_internal(best_attr, NULL, 0)
+                                     : tree_create_leaf(label, NULL, 0);
+    if(node == NULL)
+        return NULL;
+
+    node->counts = (long long*)malloc(ID3_COUNTS_SIZE * sizeof(long long));
+    if(node->counts != NULL)
+        memcpy(node->counts, counts, ID3_COUNTS_SIZE * sizeof(long long));
+
+    // frontier order keeps every parent's YES child before its NO child
+    if(entry->parent == NULL)
+        *root = node;
+    else
+        tree_attach_child(entry->parent, node);
+
+    return node;
+}
+
+tree_node* dist_coordinator_train(int listen_fd, int num_workers) {
+    if(listen_fd < 0 || num_workers <= 0) {
+        printf("Error at dist_coordinator_train: invalid arguments.\n");
+        return NULL;
+    }
+
+    int* workers = (int*)malloc(num_workers * sizeof(int));
+    if(workers == NULL) {
+        printf("Error at dist_coordinator_train: memory allocation failed.\n");
+        return NULL;
+    }
+
+    for(int w = 0; w < num_workers; w++) {
+        workers[w] = accept(listen_fd, NULL, NULL);
+        if(workers[w] < 0) {
+            perror("Error at dist_coordinator_train: accept");
+            for(int i = 0; i < w; i++)
+                close(workers[i]);
+            free(workers);
+            return NULL;
+        }
+        int enable = 1;
+        setsockopt(workers[w], IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+
+    tree_node* root = NULL;
+    int num_frontier = 1;
+    dist_frontier_node* frontier = (dist_frontier_node*)malloc(sizeof(dist_frontier_node));
+    long long* counts = (long long*)malloc(ID3_COUNTS_SIZE * sizeof(long long));
+    int failed = frontier == NULL || counts == NULL;
+
+    if(!failed) {
+        frontier[0].parent = NULL;
+        frontier[0].used_attrs = 0;
+        frontier[0].parent_majority = DEMOCRAT;
+        failed = run_round(workers, num_workers, NULL, 0, num_frontier, counts) != 0;
+    }
+
+    // one round per tree level
+    while(!failed && num_frontier > 0) {
+        dist_decision* decisions = (dist_decision*)malloc(num_frontier * sizeof(dist_decision));
+        dist_frontier_node* next = (dist_frontier_node*)malloc(2 * num_frontier * sizeof(dist_frontier_node));
+        if(decisions == NULL || next == NULL) {
+            printf("Error at dist_coordinator_train: memory allocation failed.\n");
+            free(decisions);
+            free(next);
+            failed = 1;
+            break;
+        }
+
+        int num_next = 0;
+        for(int i = 0; i < num_frontier && !failed; i++) {
+            const long long* node_counts = &counts[(size_t)i * ID3_COUNTS_SIZE];
+            long long democrat_count = ID3_CLASS_COUNT(node_counts, DEMOCRAT);
+            long long republican_count = ID3_CLASS_COUNT(node_counts, REPUBLICAN);
+
+            // empty branch: leaf with the parent's majority class
+            int majority = frontier[i].parent_majority;
+            if(democrat_count + republican_count > 0)
+                majority = (democrat_count >= republican_count) ? DEMOCRAT : REPUBLICAN;
+
+            int available[NUM_ATTRIBUTES];
+            int num_available = 0;
+            for(int a = 0; a < NUM_ATTRIBUTES; a++)
+                if(!(frontier[i].used_attrs & (1u << a)))
+                    available[num_available++] = a;
+
+            // same leaf conditions as ID3_train_rec
+            int best_attr = -1;
+            if(democrat_count > 0 && republican_count > 0 && num_available > 0)
+                best_attr = ID3_find_best_attribute_counts(node_counts, available, num_available);
+
+            tree_node* node = create_decided_node(&root, &frontier[i], best_attr, majority, node_counts);
+            if(node == NULL) {
+                failed = 1;
+                break;
+            }
+
+            decisions[i].attr_index = best_attr;
+            decisions[i].yes_child = -1;
+            decisions[i].no_child = -1;
+            if(best_attr < 0)
+                continue;
+
+            for(int branch = 0; branch < 2; branch++) {
+                next[num_next].parent = node;
+                next[num_next].used_attrs = frontier[i].used_attrs | (1u << best_attr);
+                next[num_next].parent_majority = majority;
+                if(branch == 0)
+                    decisions[i].yes_child = num_next;
+                else
+                    decisions[i].no_child = num_next;
+                num_next++;
+            }
+        }
+
+        long long* next_counts = NULL;
+        if(!failed && num_next > 0) {
+            next_counts = (long long*)malloc((size_t)num_next * ID3_COUNTS_SIZE * sizeof(long long));
+            failed = next_counts == NULL ||
+                     run_round(workers, num_workers, decisions, num_frontier, num_next, next_counts) != 0;
+        }
+
+        free(decisions);
+        free(frontier);
+        free(counts);
+        frontier = next;
+        counts = next_counts;
+        num_frontier = failed ? 0 : num_next;
+    }
+
+    long long done = DIST_MSG_DONE;
+    for(int w = 0; w < num_workers; w++) {
+        send_values(workers[w], &done, 1);
+        close(workers[w]);
+    }
+
+    free(frontier);
+    free(counts);
+    free(workers);
+
+    if(failed) {
+        tree_delete(root);
+        return NULL;
+    }
+    return root;
+}
+
+// Checks a round message against the worker's current frontier (num_current nodes,
+// first round: the root alone, no decisions) before anything is indexed with it
+static int check_round(const long long* header, int num_current, int first_round) {
+    long long num_decisions = header[1];
+    long long num_frontier = header[2];
+
+    if(first_round)
+        return num_decisions == 0 && num_frontier == 1 ? 0 : -1;
+    if(num_decisions != num_current)
+        return -1;
+    // every split adds a YES and a NO node to the next frontier,
+    // and a level never holds more than 2^NUM_ATTRIBUTES nodes
+    return num_frontier >= 0 && num_frontier <= 2 * num_decisions && num_frontier <= (1LL << NUM_ATTRIBUTES) ? 0 : -1;
+}
+
+static int check_decisions(const long long* decisions, int num_decisions, int num_frontier) {
+    for(int i = 0; i < num_decisions; i++) {
+        const long long* decision = &decisions[3 * i];
+        if(decision[0] == -1)
+            continue;
+        if(decision[0] < 0 || decision[0] >= NUM_ATTRIBUTES ||
+           decision[1] < 0 || decision[1] >= num_frontier || decision[2] < 0 || decision[2] >= num_frontier)
+            return -1;
+    }
+    return 0;
+}
+
+int dist_worker_run(const char* host, int port, const char* data_path, int shard, int num_shards) {
+    if(num_shards <= 0 || shard < 0 || shard >= num_shards) {
+        printf("Error at dist_worker_run: invalid shard %d of %d.\n", shard, num_shards);
+        return -1;
+    }
+
+    int num_records = 0;
+    input_record* records = input_read_shard(data_path, shard, num_shards, &num_records);
+    if(records == NULL)
+        return -1;
+
+    // frontier node of every record, -1 once it reached a leaf
+    int* node_of = (int*)calloc(num_records > 0 ? num_records : 1, sizeof(int));
+    if(node_of == NULL) {
+        printf("Error at dist_worker_run: memory allocation failed.\n");
+        free(records);
+        return -1;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((unsigned short)port);
+    if(inet_pton(AF_INET, host, &address.sin_addr) != 1) {
+        printf("Error at dist_worker_run: invalid address %s.\n", host);
+        free(records);
+        free(node_of);
+        return -1;
+    }
+
+    int fd = -1;
+    for(int attempt = 0; attempt < DIST_CONNECT_RETRIES; attempt++) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if(fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0)
+            break;
+        if(fd >= 0)
+            close(fd);
+        fd = -1;
+        sleep(1);
+    }
+    if(fd < 0) {
+        printf("Error at dist_worker_run: could not connect to %s:%d.\n", host, port);
+        free(records);
+        free(node_of);
+        return -1;
+    }
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    int status = 0;
+    int num_current = 1;  // nodes of the current frontier
+    int first_round = 1;
+    while(status == 0) {
+        long long header[3];
+        if(recv_values(fd, header, 1) != 0) {
+            status = -1;
+            break;
+        }
+        if(header[0] == DIST_MSG_DONE)
+            break;
+        if(header[0] != DIST_MSG_ROUND || recv_values(fd, header + 1, 2) != 0) {
+            status = -1;
+            break;
+        }
+        if(check_round(header, num_current, first_round) != 0) {
+            printf("Error at dist_worker_run: invalid round message.\n");
+            status = -1;
+            break;
+        }
+
+        int num_decisions = (int)header[1];
+        int num_frontier = (int)header[2];
+        long long* decisions = (long long*)malloc((3 * (size_t)num_decisions + 1) * sizeof(long long));
+        long long* counts = (long long*)calloc((size_t)num_frontier * ID3_COUNTS_SIZE + 1, sizeof(long long));
+        if(decisions == NULL || counts == NULL || recv_values(fd, decisions, 3 * num_decisions) != 0) {
+            free(decisions);
+            free(counts);
+            status = -1;
+            break;
+        }
+        if(check_decisions(decisions, num_decisions, num_frontier) != 0) {
+            printf("Error at dist_worker_run: invalid split decision.\n");
+            free(decisions);
+            free(counts);
+            status = -1;
+            break;
+        }
+
+        // move every record to its child (or retire it at a leaf), then count the new frontier
+        for(int i = 0; i < num_records; i++) {
+            int node = node_of[i];
+            if(node < 0)
+                continue;
+
+            if(num_decisions > 0) {
+                const long long* decision = &decisions[3 * node];
+                if(decision[0] < 0)
+                    node = -1;
+                else
+                    node = (int)(records[i].attributes[decision[0]] == YES ? decision[1] : decision[2]);
+                node_of[i] = node;
+                if(node < 0)
+                    continue;
+            }
+
+            long long* node_counts = &counts[(size_t)node * ID3_COUNTS_SIZE];
+            ID3_CLASS_COUNT(node_counts, records[i].label)++;
+            for(int a = 0; a < NUM_ATTRIBUTES; a++)
+                ID3_ATTR_COUNT(node_counts, a, records[i].attributes[a], records[i].label)++;
+        }
+
+        status = send_values(fd, counts, num_frontier * ID3_COUNTS_SIZE);
+        free(decisions);
+        free(counts);
+        num_current = num_frontier;
+        first_round = 0;
+    }
+
+    if(status != 0)
+        printf("Error at dist_worker_run: connection to the coordinator failed.\n");
+
+    close(fd);
+    free(records);
+    free(node_of);
+    return status;
+}
@@ -3,15 +3,30 @@
 #include <string.h>
 
 #include <input.h>
+#include <trace.h>
 
-#define BUF_SIZE 256
+// Initial number of slots of the collapsing hash table (power of two)
+#define COLLAPSE_INITIAL_SLOTS 1024
+
+#if INPUT_BINARY_RECORD_SIZE > 8
+#error "input_collapse_records uses the packed record as a 64-bit key"
+#endif
 
 int input_get_num_records() {
+    return input_get_num_records_file(INPUT_DEFAULT_PATH);
+}
+
+input_record* input_read() {
+    int num_records;
+    return input_read_file(INPUT_DEFAULT_PATH, &num_records);
+}
+
+int input_get_num_records_file(const char* path) {
     FILE *input_file;
     int lineno = 0;
-    char buffer[BUF_SIZE];
+    char buffer[INPUT_MAX_LINE + 2];
 
-    input_file = fopen("../input.txt", "r");
+    input_file = fopen(path, "r");
     if (input_file == NULL) {
         perror("Error opening file");
         return -1;
@@ -25,17 +40,19 @@ int input_get_num_records() {
     return lineno;
 }
 
-input_record* input_read() {
-    FILE *input_file, *linecounter;
+input_record* input_read_file(const char* path, int* num_records) {
+    FILE *input_file;
+    TRACE_START(load_start);
     
-    int lineno = input_get_num_records();
+    int lineno = input_get_num_records_file(path);
+    *num_records = 0;
 
     if (lineno <= 0) {
         fprintf(stderr, "Error at input_read(): no valid records found.\n");
         return NULL;
     }
 
-    char buffer[BUF_SIZE];
+    char buffer[INPUT_MAX_LINE + 2];
     input_record* records = (input_record*)malloc(lineno * sizeof(input_record));
 
     if(records == NULL) {
@@ -43,43 +60,548 @@ input_record* input_read() {
         return NULL;
     }
     
-    input_file = fopen("../input.txt", "r");
-
-    memset(buffer, 0, sizeof(buffer));
-    int i = 0, j;
-    while(i < lineno) {
-        fgets(buffer, sizeof(buffer), input_file);
-        char *p = buffer;
-        j = 0;
-
-        while(j < NUM_ATTRIBUTES) {
-            if(*p == 'y' || *p == 'n') {
-                records[i].attributes[j] = *p == 'y' ? YES : NO;
-                p += 2; // Move past the attribute and the comma
-            } else {
-                fprintf(stderr, "Invalid attribute value: \'%c\'\n", *p);
-                fclose(input_file);
+    input_file = fopen(path, "r");
+    if (input_file == NULL) {
+        perror("Error opening file");
+        free(records);
+        return NULL;
+    }
+
+    // lineno bounds the number of records: blank lines are skipped
+    int kept = 0;
+    for(int line = 1; kept < lineno && fgets(buffer, sizeof(buffer), input_file) != NULL; line++) {
+        size_t length = strlen(buffer);
+        if (length > 0 && buffer[length - 1] == '\n') {
+            length--;
+        } else if (!feof(input_file)) {
+            fprintf(stderr, "Error at input_read(): line %d is too long.\n", line);
+            fclose(input_file);
+            free(records);
+            return NULL;
+        }
+
+        input_parse_status status = input_parse_line(buffer, buffer + length, &records[kept]);
+        if (status == INPUT_PARSE_BLANK)
+            continue;
+        if (status != INPUT_PARSE_OK) {
+            input_print_parse_error("input_read", status, buffer, buffer + length, line);
+            fclose(input_file);
+            free(records);
+            return NULL;
+        }
+        kept++;
+    }
+
+    fclose(input_file);
+    if (kept == 0) {
+        fprintf(stderr, "Error at input_read(): no valid records found.\n");
+        free(records);
+        return NULL;
+    }
+
+    *num_records = kept;
+    TRACE_STOP(load_start, TRACE_LOAD, 0, kept);
+    return records;
+}
+
+// Parses the attributes of [p, last) into record
+// Returns the number of valid attributes (NUM_ATTRIBUTES on success)
+static int parse_attributes(const char* p, const char* last, input_record* record) {
+    for(int j = 0; j < NUM_ATTRIBUTES; j++) {
+        if(last - p < 2 || (*p != 'y' && *p != 'n'))
+            return j;
+        record->attributes[j] = *p == 'y' ? YES : NO;
+        p += 2; // Move past the attribute and the comma
+    }
+    return NUM_ATTRIBUTES;
+}
+
+// End of the line without trailing '\r' and blanks
+static const char* trim_line(const char* line, const char* end) {
+    while(end > line && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+        end--;
+    return end;
+}
+
+input_parse_status input_parse_line(const char* line, const char* end, input_record* record) {
+    const char* last = trim_line(line, end);
+    if(last == line)
+        return INPUT_PARSE_BLANK;
+
+    int valid = parse_attributes(line, last, record);
+    const char* p = line + 2 * valid;
+    if(valid < NUM_ATTRIBUTES)
+        return last - p < 2 ? INPUT_PARSE_TRUNCATED : INPUT_PARSE_INVALID_ATTRIBUTE;
+    if(p == last)
+        return INPUT_PARSE_TRUNCATED;
+
+    int length;
+    if(last - p >= 8 && strncmp(p, "democrat", 8) == 0) {
+        record->label = DEMOCRAT;
+        length = 8;
+    } else if(last - p >= 10 && strncmp(p, "republican", 10) == 0) {
+        record->label = REPUBLICAN;
+        length = 10;
+    } else {
+        return INPUT_PARSE_INVALID_LABEL;
+    }
+
+    return p + length == last ? INPUT_PARSE_OK : INPUT_PARSE_TRAILING;
+}
+
+void input_print_parse_error(const char* caller, input_parse_status status,
+                             const char* line, const char* end, long long lineno) {
+    input_record record;
+    switch(status) {
+    case INPUT_PARSE_TRUNCATED:
+        fprintf(stderr, "Error at %s(): truncated record at line %lld.\n", caller, lineno);
+        break;
+    case INPUT_PARSE_INVALID_ATTRIBUTE:
+        fprintf(stderr, "Invalid attribute value: \'%c\' at line %lld\n",
+                line[2 * parse_attributes(line, trim_line(line, end), &record)], lineno);
+        break;
+    case INPUT_PARSE_INVALID_LABEL:
+        fprintf(stderr, "Invalid class label at line %lld\n", lineno);
+        break;
+    case INPUT_PARSE_TRAILING:
+        fprintf(stderr, "Error at %s(): unexpected characters after the class label at line %lld.\n", caller, lineno);
+        break;
+    default:
+        break;
+    }
+}
+
+int input_write_records(FILE* file, const input_record* records, int num_records) {
+    char buffer[(INPUT_MAX_LINE + 1) * 64];
+    size_t used = 0;
+
+    for(int i = 0; i < num_records; i++) {
+        // flush before a line could overflow the buffer
+        if(used + INPUT_MAX_LINE + 1 > sizeof(buffer)) {
+            if(fwrite(buffer, 1, used, file) != used)
+                return -1;
+            used = 0;
+        }
+
+        for(int j = 0; j < NUM_ATTRIBUTES; j++) {
+            buffer[used++] = records[i].attributes[j] == YES ? 'y' : 'n';
+            buffer[used++] = ',';
+        }
+
+        const char* label = class_label_to_string(records[i].label);
+        size_t length = strlen(label);
+        memcpy(buffer + used, label, length);
+        used += length;
+        buffer[used++] = '\n';
+    }
+
+    if(used > 0 && fwrite(buffer, 1, used, file) != used)
+        return -1;
+    return 0;
+}
+
+void input_pack_record(const input_record* record, unsigned char* out) {
+    // accumulate in a register: out may alias record, byte-wise |= would reload every time
+    unsigned long long bits = record->label == REPUBLICAN ? 1ULL << NUM_ATTRIBUTES : 0;
+    for(int j = 0; j < NUM_ATTRIBUTES; j++)
+        bits |= (unsigned long long)(record->attributes[j] == YES) << j;
+
+    for(int b = 0; b < INPUT_BINARY_RECORD_SIZE; b++)
+        out[b] = (unsigned char)(bits >> (8 * b));
+}
+
+void input_unpack_record(const unsigned char* in, input_record* record) {
+    for(int j = 0; j < NUM_ATTRIBUTES; j++)
+        record->attributes[j] = (in[j / 8] >> (j % 8)) & 1 ? YES : NO;
+    record->label = (in[NUM_ATTRIBUTES / 8] >> (NUM_ATTRIBUTES % 8)) & 1 ? REPUBLICAN : DEMOCRAT;
+}
+
+int input_write_binary_header(FILE* file, unsigned long long num_records) {
+    unsigned char header[INPUT_BINARY_HEADER_SIZE];
+    unsigned int num_attributes = NUM_ATTRIBUTES;
+
+    memcpy(header, INPUT_BINARY_MAGIC, 4);
+    for(int i = 0; i < 4; i++)
+        header[4 + i] = (unsigned char)(num_attributes >> (8 * i));
+    for(int i = 0; i < 8; i++)
+        header[8 + i] = (unsigned char)(num_records >> (8 * i));
+
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header) ? 0 : -1;
+}
+
+int input_write_binary(FILE* file, const input_record* records, int num_records) {
+    unsigned char buffer[INPUT_BINARY_RECORD_SIZE * 4096];
+    int used = 0;
+
+    for(int i = 0; i < num_records; i++) {
+        input_pack_record(&records[i], buffer + used);
+        used += INPUT_BINARY_RECORD_SIZE;
+
+        if(used == (int)sizeof(buffer) || i + 1 == num_records) {
+            if(fwrite(buffer, 1, used, file) != (size_t)used)
+                return -1;
+            used = 0;
+        }
+    }
+    return 0;
+}
+
+// Reads and validates the binary header of input_file (magic included);
+// returns the number of records, 0 on error (reported as coming from caller)
+unsigned long long input_decode_binary_header(const unsigned char* header, const char* caller) {
+    if (memcmp(header, INPUT_BINARY_MAGIC, 4) != 0) {
+        fprintf(stderr, "Error at %s(): invalid header.\n", caller);
+        return 0;
+    }
+
+    unsigned int num_attributes = 0;
+    unsigned long long count = 0;
+    for(int i = 0; i < 4; i++)
+        num_attributes |= (unsigned int)header[4 + i] << (8 * i);
+    for(int i = 0; i < 8; i++)
+        count |= (unsigned long long)header[8 + i] << (8 * i);
+
+    if (num_attributes != NUM_ATTRIBUTES || count == 0 || count > 0x7fffffffULL) {
+        fprintf(stderr, "Error at %s(): unsupported file (%u attributes, %llu records).\n",
+                caller, num_attributes, count);
+        return 0;
+    }
+    return count;
+}
+
+static unsigned long long read_binary_header(FILE* input_file, const char* caller) {
+    unsigned char header[INPUT_BINARY_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), input_file) != sizeof(header)) {
+        fprintf(stderr, "Error at %s(): invalid header.\n", caller);
+        return 0;
+    }
+    return input_decode_binary_header(header, caller);
+}
+
+input_record* input_read_binary_file(const char* path, int* num_records) {
+    TRACE_START(load_start);
+    *num_records = 0;
+
+    FILE* input_file = fopen(path, "rb");
+    if (input_file == NULL) {
+        perror("Error opening file");
+        return NULL;
+    }
+
+    unsigned long long count = read_binary_header(input_file, "input_read_binary_file");
+    if (count == 0) {
+        fclose(input_file);
+        return NULL;
+    }
+
+    input_record* records = (input_record*)malloc(count * sizeof(input_record));
+    if(records == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        fclose(input_file);
+        return NULL;
+    }
+
+    unsigned char buffer[INPUT_BINARY_RECORD_SIZE * 4096];
+    unsigned long long done = 0;
+    while(done < count) {
+        size_t want = count - done < 4096 ? (size_t)(count - done) : 4096;
+        if(fread(buffer, INPUT_BINARY_RECORD_SIZE, want, input_file) != want) {
+            fprintf(stderr, "Error at input_read_binary_file(): truncated file.\n");
+            free(records);
+            fclose(input_file);
+            return NULL;
+        }
+        for(size_t i = 0; i < want; i++)
+            input_unpack_record(buffer + i * INPUT_BINARY_RECORD_SIZE, &records[done + i]);
+        done += want;
+    }
+
+    fclose(input_file);
+    *num_records = (int)count;
+    TRACE_STOP(load_start, TRACE_LOAD, 0, count);
+    return records;
+}
+
+// Binary part of input_read_shard: input_file is positioned at the header
+static input_record* read_binary_shard(FILE* input_file, int shard, int num_shards, int* num_records) {
+    unsigned long long count = read_binary_header(input_file, "input_read_shard");
+    if (count == 0)
+        return NULL;
+
+    // exact size of the shard
+    long long shard_size = count > (unsigned long long)shard ? ((long long)count - shard - 1) / num_shards + 1 : 0;
+    input_record* records = (input_record*)malloc((shard_size > 0 ? shard_size : 1) * sizeof(input_record));
+    if (records == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+
+    unsigned char buffer[INPUT_BINARY_RECORD_SIZE * 4096];
+    unsigned long long done = 0;
+    int kept = 0;
+    while(done < count) {
+        size_t want = count - done < 4096 ? (size_t)(count - done) : 4096;
+        if (fread(buffer, INPUT_BINARY_RECORD_SIZE, want, input_file) != want) {
+            fprintf(stderr, "Error at input_read_shard(): truncated file.\n");
+            free(records);
+            return NULL;
+        }
+        for(size_t i = 0; i < want; i++) {
+            if ((done + i) % num_shards == (unsigned long long)shard)
+                input_unpack_record(buffer + i * INPUT_BINARY_RECORD_SIZE, &records[kept++]);
+        }
+        done += want;
+    }
+
+    *num_records = kept;
+    return records;
+}
+
+// Text part of input_read_shard: every line is a record, as in input_read_file
+static input_record* read_text_shard(FILE* input_file, int shard, int num_shards, int* num_records) {
+    int capacity = 1024;
+    int kept = 0;
+    input_record* records = (input_record*)malloc(capacity * sizeof(input_record));
+    if (records == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+    long long lineno = 0;
+    while((length = getline(&line, &line_capacity, input_file)) >= 0) {
+        if (lineno++ % num_shards != shard)
+            continue;
+
+        if (kept == capacity) {
+            input_record* grown = capacity <= 0x3fffffff
+                                  ? (input_record*)realloc(records, (size_t)capacity * 2 * sizeof(input_record)) : NULL;
+            if (grown == NULL) {
+                fprintf(stderr, "Memory reallocation failed\n");
+                free(records);
+                free(line);
                 return NULL;
             }
-            j++;
+            records = grown;
+            capacity *= 2;
         }
 
-        if (strncmp(p, "democrat", 8) == 0) {
-            records[i].label = DEMOCRAT;
-        } else if (strncmp(p, "republican", 10) == 0) {
-            records[i].label = REPUBLICAN;
-        } else {
-            fprintf(stderr, "Invalid class label: %s\n", p);
-            fclose(input_file);
+        size_t content = (size_t)length;
+        if (content > 0 && line[content - 1] == '\n')
+            content--;
+        if (content > INPUT_MAX_LINE) {
+            fprintf(stderr, "Error at input_read_shard(): line %lld is too long.\n", lineno);
+            free(records);
+            free(line);
+            return NULL;
+        }
+        input_parse_status status = input_parse_line(line, line + content, &records[kept]);
+        if (status == INPUT_PARSE_BLANK)
+            continue;
+        if (status != INPUT_PARSE_OK) {
+            input_print_parse_error("input_read_shard", status, line, line + content, lineno);
+            free(records);
+            free(line);
             return NULL;
         }
-        i++;
+        kept++;
+    }
+    free(line);
+
+    if (lineno == 0) {
+        fprintf(stderr, "Error at input_read_shard(): no valid records found.\n");
+        free(records);
+        return NULL;
+    }
+
+    *num_records = kept;
+    return records;
+}
+
+input_record* input_read_shard(const char* path, int shard, int num_shards, int* num_records) {
+    TRACE_START(load_start);
+    *num_records = 0;
+    if (num_shards <= 0 || shard < 0 || shard >= num_shards) {
+        fprintf(stderr, "Error at input_read_shard(): invalid shard %d of %d.\n", shard, num_shards);
+        return NULL;
+    }
+
+    FILE* input_file = fopen(path, "rb");
+    if (input_file == NULL) {
+        perror("Error opening file");
+        return NULL;
     }
 
+    char magic[4] = { 0 };
+    size_t got = fread(magic, 1, sizeof(magic), input_file);
+    rewind(input_file);
+
+    input_record* records = got == sizeof(magic) && memcmp(magic, INPUT_BINARY_MAGIC, 4) == 0
+                            ? read_binary_shard(input_file, shard, num_shards, num_records)
+                            : read_text_shard(input_file, shard, num_shards, num_records);
+
     fclose(input_file);
+    TRACE_STOP(load_start, TRACE_LOAD, 0, *num_records);
     return records;
 }
 
+// Record packed as a key: the binary encoding of input_pack_record, little endian
+static unsigned long long record_key(const input_record* record) {
+    unsigned char packed[INPUT_BINARY_RECORD_SIZE];
+    input_pack_record(record, packed);
+
+    unsigned long long key = 0;
+    for(int b = 0; b < INPUT_BINARY_RECORD_SIZE; b++)
+        key |= (unsigned long long)packed[b] << (8 * b);
+    return key;
+}
+
+static unsigned long long hash_key(unsigned long long key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return key;
+}
+
+input_collapser* input_collapser_create(void) {
+    input_collapser* collapser = (input_collapser*)calloc(1, sizeof(input_collapser));
+    if (collapser == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+
+    collapser->num_slots = COLLAPSE_INITIAL_SLOTS;
+    collapser->capacity = 64;
+    collapser->slots = (int*)malloc(collapser->num_slots * sizeof(int));
+    collapser->keys = (unsigned long long*)malloc(collapser->capacity * sizeof(unsigned long long));
+    collapser->unique = (input_record*)malloc(collapser->capacity * sizeof(input_record));
+    collapser->weights = (long long*)malloc(collapser->capacity * sizeof(long long));
+
+    if (collapser->slots == NULL || collapser->keys == NULL || collapser->unique == NULL || collapser->weights == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        input_collapser_free(collapser);
+        return NULL;
+    }
+    memset(collapser->slots, -1, collapser->num_slots * sizeof(int));
+    return collapser;
+}
+
+void input_collapser_free(input_collapser* collapser) {
+    if (collapser == NULL)
+        return;
+
+    free(collapser->slots);
+    free(collapser->keys);
+    free(collapser->unique);
+    free(collapser->weights);
+    free(collapser);
+}
+
+int input_collapser_add(input_collapser* collapser, const input_record* record) {
+    unsigned long long key = record_key(record);
+    unsigned long long slot = hash_key(key) & (collapser->num_slots - 1);
+
+    while(collapser->slots[slot] >= 0 && collapser->keys[collapser->slots[slot]] != key)
+        slot = (slot + 1) & (collapser->num_slots - 1);
+
+    if (collapser->slots[slot] >= 0) {
+        collapser->weights[collapser->slots[slot]]++;
+        return 0;
+    }
+
+    // new distinct record
+    if (collapser->count == collapser->capacity) {
+        int capacity = collapser->capacity * 2;
+        unsigned long long* new_keys = (unsigned long long*)realloc(collapser->keys, capacity * sizeof(unsigned long long));
+        if (new_keys != NULL) collapser->keys = new_keys;
+        input_record* new_unique = (input_record*)realloc(collapser->unique, capacity * sizeof(input_record));
+        if (new_unique != NULL) collapser->unique = new_unique;
+        long long* new_weights = (long long*)realloc(collapser->weights, capacity * sizeof(long long));
+        if (new_weights != NULL) collapser->weights = new_weights;
+
+        if (new_keys == NULL || new_unique == NULL || new_weights == NULL) {
+            fprintf(stderr, "Memory reallocation failed\n");
+            return -1;
+        }
+        collapser->capacity = capacity;
+    }
+
+    int count = collapser->count;
+    collapser->keys[count] = key;
+    collapser->unique[count] = *record;
+    collapser->weights[count] = 1;
+    collapser->slots[slot] = count;
+    collapser->count = ++count;
+
+    // keep the load factor under 1/2 (rehash into a table twice as large)
+    if (2 * count > collapser->num_slots) {
+        int new_num_slots = collapser->num_slots * 2;
+        int* new_slots = (int*)malloc(new_num_slots * sizeof(int));
+        if (new_slots == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            return -1;
+        }
+        memset(new_slots, -1, new_num_slots * sizeof(int));
+        for(int u = 0; u < count; u++) {
+            unsigned long long s = hash_key(collapser->keys[u]) & (new_num_slots - 1);
+            while(new_slots[s] >= 0)
+                s = (s + 1) & (new_num_slots - 1);
+            new_slots[s] = u;
+        }
+        free(collapser->slots);
+        collapser->slots = new_slots;
+        collapser->num_slots = new_num_slots;
+    }
+    return 0;
+}
+
+input_record* input_collapser_finish(input_collapser* collapser, int* num_unique, long long** weights) {
+    *num_unique = 0;
+    *weights = NULL;
+
+    input_record* unique = NULL;
+    int count = collapser->count;
+    if (count > 0) {
+        // shrink to fit
+        unique = collapser->unique;
+        input_record* shrunk = (input_record*)realloc(unique, count * sizeof(input_record));
+        if (shrunk != NULL) unique = shrunk;
+        long long* shrunk_weights = (long long*)realloc(collapser->weights, count * sizeof(long long));
+        if (shrunk_weights != NULL) collapser->weights = shrunk_weights;
+
+        *num_unique = count;
+        *weights = collapser->weights;
+        collapser->unique = NULL;
+        collapser->weights = NULL;
+    }
+
+    input_collapser_free(collapser);
+    return unique;
+}
+
+input_record* input_collapse_records(const input_record* records, int num_records,
+                                     int* num_unique, long long** weights) {
+    *num_unique = 0;
+    *weights = NULL;
+    if (records == NULL || num_records <= 0)
+        return NULL;
+
+    input_collapser* collapser = input_collapser_create();
+    if (collapser == NULL)
+        return NULL;
+
+    for(int i = 0; i < num_records; i++) {
+        if (input_collapser_add(collapser, &records[i]) != 0) {
+            input_collapser_free(collapser);
+            return NULL;
+        }
+    }
+
+    return input_collapser_finish(collapser, num_unique, weights);
+}
+
 void input_print_records(input_record* records, int num_records) {
     if (records == NULL) {
         printf("No records to print.\n");
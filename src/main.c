@@ -1,41 +1,251 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include <tree.h>
 #include <input.h>
 #include <ID3.h>
+#include <boost.h>
+#include <distributed.h>
+#include <pipeline.h>
+#include <score.h>
 
-int main() {
+// Trains a gradient-boosted ensemble on the problem's training set, holding out
+// its last BOOST_VALIDATION_RATIO part for early stopping (numa: see placement.h)
+static void run_boosting(ID3_problem* problem, int train_size, int test_size, int numa) {
+    int valid_size = (int)(train_size * BOOST_VALIDATION_RATIO);
+    int fit_size = train_size - valid_size;
 
-    // Read all input records
-    input_record* records = input_read();
-    if (records == NULL) {
-        printf("Error at main: could not read input records.\n");
+    int* indices = (int*)malloc(train_size * sizeof(int));
+    if(indices == NULL) {
+        printf("Error at run_boosting: memory allocation failed.\n");
+        return;
+    }
+    for(int i = 0; i < train_size; i++)
+        indices[i] = i;
+
+    boost_params params = boost_default_params();
+    params.numa = numa;
+    boost_model* model = boost_train(problem->training_set, indices, fit_size,
+                                     indices + fit_size, valid_size, &params);
+    free(indices);
+    if(model == NULL)
+        return;
+
+    printf("Boosted trees: %d (best validation log-loss %.4f)\n", model->num_trees, model->best_loss);
+    printf("Boosting testing accuracy: %.2f%%\n", boost_begin_testing(model, problem->testing_set, test_size) * 100);
+
+    boost_free_model(model);
+}
+
+// Trains on listen_fd with num_workers workers and prints the tree
+static int run_coordinator(int listen_fd, int num_workers) {
+    tree_node* root = dist_coordinator_train(listen_fd, num_workers);
+    close(listen_fd);
+    if(root == NULL)
+        return 1;
+
+    tree_print(root);
+    tree_delete(root);
+    return 0;
+}
+
+// Classifies the records of data_path (stdin if NULL) with a saved model, labels to stdout
+static int run_scoring(const char* model_path, const char* data_path, int numa) {
+    tree_node* root = tree_load(model_path);
+    if(root == NULL)
         return 1;
+
+    FILE* in = stdin;
+    if(data_path != NULL) {
+        in = fopen(data_path, "rb");
+        if(in == NULL) {
+            perror("Error opening file");
+            tree_delete(root);
+            return 1;
+        }
     }
 
-    int num_records = input_get_num_records();
-    if (num_records <= 0) {
-        printf("Error at main: invalid number of records.\n");
-        free(records);
+    long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long long scored = score_stream(root, in, stdout, num_threads > 0 ? (int)num_threads : 1, numa);
+
+    if(in != stdin)
+        fclose(in);
+    tree_delete(root);
+    return scored < 0 ? 1 : 0;
+}
+
+// Forks num_workers local workers, each one loading a shard of the default dataset,
+// and coordinates them from this process
+static int run_distributed(int num_workers) {
+    int port = 0;
+    int listen_fd = dist_listen(0, &port);
+    if(listen_fd < 0)
         return 1;
+
+    // flush before forking so buffered output is not duplicated
+    fflush(stdout);
+
+    int forked = 0;
+    for(int w = 0; w < num_workers; w++) {
+        pid_t pid = fork();
+        if(pid == 0) {
+            close(listen_fd);
+            int status = dist_worker_run("127.0.0.1", port, INPUT_DEFAULT_PATH, w, num_workers);
+            fflush(stdout);
+            _exit(status == 0 ? 0 : 1);
+        }
+        if(pid < 0) {
+            perror("Error at run_distributed: fork");
+            break;
+        }
+        forked++;
     }
 
-    ID3_problem* problem = ID3_generate_problem(records, num_records);
+    int status = 1;
+    if(forked == num_workers)
+        status = run_coordinator(listen_fd, num_workers);
+    else
+        close(listen_fd);
 
-    int train_size = (int)(num_records * TRAINING_SET_RATIO);
-    int test_size = num_records - train_size;
+    // workers that never connected give up on their own (see DIST_CONNECT_RETRIES)
+    for(int w = 0; w < forked; w++) {
+        int worker_status = 0;
+        if(wait(&worker_status) < 0 || !WIFEXITED(worker_status) || WEXITSTATUS(worker_status) != 0)
+            status = 1;
+    }
+    return status;
+}
 
-    free(records);
+int main(int argc, char** argv) {
+
+    // Distributed modes (see distributed.h): train on the whole dataset, no testing split
+    if(argc == 3 && strcmp(argv[1], "--distributed") == 0) {
+        int num_workers = atoi(argv[2]);
+        if(num_workers <= 0) {
+            printf("Error at main: invalid number of workers.\n");
+            return 1;
+        }
+        return run_distributed(num_workers);
+    }
+    if(argc == 4 && strcmp(argv[1], "--coordinator") == 0) {
+        int num_workers = atoi(argv[3]);
+        int listen_fd = num_workers > 0 ? dist_listen(atoi(argv[2]), NULL) : -1;
+        if(listen_fd < 0) {
+            printf("Error at main: could not start the coordinator.\n");
+            return 1;
+        }
+        return run_coordinator(listen_fd, num_workers);
+    }
+    // Scoring mode (see score.h): labels only on stdout, errors on stderr
+    if(argc >= 3 && argc <= 5 && strcmp(argv[1], "--score") == 0) {
+        int numa = strcmp(argv[argc - 1], "--numa") == 0;
+        if(argc - numa <= 4)
+            return run_scoring(argv[2], argc - numa == 4 ? argv[3] : NULL, numa);
+    }
+    if(argc == 7 && strcmp(argv[1], "--worker") == 0)
+        return dist_worker_run(argv[2], atoi(argv[3]), argv[4], atoi(argv[5]), atoi(argv[6])) == 0 ? 0 : 1;
+
+    int use_boosting = 0;
+    int collapse = 0;
+    int pipelined = 0;
+    int numa = 0;
+    const char* model_path = NULL;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--boost") == 0) {
+            use_boosting = 1;
+        } else if(strcmp(argv[i], "--collapse") == 0) {
+            collapse = 1;
+        } else if(strcmp(argv[i], "--pipeline") == 0) {
+            pipelined = 1;
+        } else if(strcmp(argv[i], "--numa") == 0) {
+            numa = 1;
+        } else if(strcmp(argv[i], "--save-model") == 0 && i + 1 < argc) {
+            model_path = argv[++i];
+        } else {
+            printf("Usage: %s [--boost] [--collapse] [--pipeline] [--numa] [--save-model MODEL]\n"
+                   "       %s --score MODEL [DATA_PATH] [--numa]\n"
+                   "       %s --distributed NUM_WORKERS\n"
+                   "       %s --coordinator PORT NUM_WORKERS\n"
+                   "       %s --worker HOST PORT DATA_PATH SHARD NUM_SHARDS\n",
+                   argv[0], argv[0], argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    // boosting trains on unweighted records
+    if(use_boosting && collapse) {
+        printf("Error at main: --boost and --collapse cannot be combined.\n");
+        return 1;
+    }
+
+    ID3_problem* problem = NULL;
+    long long* root_counts = NULL;
+    int train_size = 0, test_size = 0;
+
+    if(pipelined) {
+        // Read, split, count the root (and collapse) in one pass (see pipeline.h)
+        problem = pipeline_load(INPUT_DEFAULT_PATH, PIPELINE_DEFAULT_SEED, collapse, &root_counts, &test_size);
+        if(problem == NULL) {
+            printf("Error at main: could not read input records.\n");
+            return 1;
+        }
+        train_size = problem->training_set_size;
+        if(collapse)
+            printf("Collapsed %lld training records into %d weighted records\n",
+                   ID3_CLASS_COUNT(root_counts, DEMOCRAT) + ID3_CLASS_COUNT(root_counts, REPUBLICAN), train_size);
+    } else {
+        // Read all input records
+        input_record* records = input_read();
+        if (records == NULL) {
+            printf("Error at main: could not read input records.\n");
+            return 1;
+        }
+
+        int num_records = input_get_num_records();
+        if (num_records <= 0) {
+            printf("Error at main: invalid number of records.\n");
+            free(records);
+            return 1;
+        }
+
+        problem = ID3_generate_problem(records, num_records);
+
+        train_size = (int)(num_records * TRAINING_SET_RATIO);
+        test_size = num_records - train_size;
+
+        free(records);
+    }
+
+    // Optional pre-aggregation of duplicate training records into weighted ones
+    // (after the full load here: the shuffled split needs every record)
+    if(collapse && !pipelined) {
+        if(ID3_collapse_training_set(problem) != 0) {
+            free(root_counts);
+            ID3_free_problem(problem);
+            return 1;
+        }
+        printf("Collapsed %d training records into %d weighted records\n", train_size, problem->training_set_size);
+        train_size = problem->training_set_size;
+    }
 
     // Begin training (decision tree construction)
-    ID3_begin_training(problem, train_size);
+    // collapsing keeps the weighted root counts unchanged
+    ID3_begin_training_counts(problem, train_size, root_counts);
 
     tree_print(problem->root);
 
+    if(model_path != NULL && tree_save(problem->root, model_path) == 0)
+        printf("Model saved to %s\n", model_path);
+
     float accuracy = ID3_begin_testing(problem, test_size);
     printf("Testing accuracy: %.2f%%\n", accuracy * 100);
 
+    if(use_boosting)
+        run_boosting(problem, train_size, test_size, numa);
+
     ID3_free_problem(problem);
     return 0;
 }
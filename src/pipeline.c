@@ -0,0 +1,589 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#ifdef ID3_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <pipeline.h>
+#include <trace.h>
+
+// Initial capacity slack of the training/testing sets over the size estimate
+#define PIPELINE_CAPACITY_SLACK 1.05
+
+typedef enum {
+    READER_SYNC,    // no asynchronous backend available: blocks are read on demand
+    READER_THREAD,  // a reader thread fills the free slots with pread
+    READER_URING    // reads are queued on an io_uring
+} reader_backend;
+
+// Asynchronous block reader: block b lives in slot b % PIPELINE_QUEUE_DEPTH,
+// a slot is refilled with block b + PIPELINE_QUEUE_DEPTH once block b is released
+typedef struct block_reader {
+    reader_backend backend;
+    int            fd;
+    long long      file_size;
+    long long      num_blocks;
+    long long      current;    // block returned by the last reader_next, -1 before
+    char*          buffers[PIPELINE_QUEUE_DEPTH];
+    long long      lengths[PIPELINE_QUEUE_DEPTH];  // bytes read into each slot, -1 on error
+    int            ready[PIPELINE_QUEUE_DEPTH];
+
+    // READER_THREAD
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    long long       released;  // blocks below this one were consumed
+    int             stop;
+
+#ifdef ID3_HAVE_LIBURING
+    struct io_uring ring;
+    int             in_flight;
+#endif
+} block_reader;
+
+// Parsing state of pipeline_load
+typedef struct pipeline_state {
+    unsigned long long seed;
+    unsigned long long train_threshold;
+    long long          position;      // records parsed so far
+    long long          lineno;
+
+    input_record*      training_set;
+    int                train_size;
+    int                train_capacity;
+    input_record*      testing_set;
+    int                test_size;
+    int                test_capacity;
+    long long*         counts;        // count table of the training set
+    input_collapser*   collapser;     // training records are collapsed as parsed, NULL if not
+
+    int                binary;
+    long long          binary_remaining;  // records still expected in a binary file
+    char               carry[INPUT_MAX_LINE];  // partial line/record at the end of a block
+    int                carry_length;
+} pipeline_state;
+
+static long long block_length(const block_reader* reader, long long block) {
+    long long offset = block * PIPELINE_BLOCK_SIZE;
+    long long remaining = reader->file_size - offset;
+    return remaining < PIPELINE_BLOCK_SIZE ? remaining : PIPELINE_BLOCK_SIZE;
+}
+
+// pread until length bytes are read or end of file; returns the bytes read, -1 on error
+static long long read_fully(int fd, char* buffer, long long length, long long offset) {
+    long long done = 0;
+    while(done < length) {
+        ssize_t result = pread(fd, buffer + done, (size_t)(length - done), (off_t)(offset + done));
+        if(result < 0 && errno == EINTR)
+            continue;
+        if(result < 0)
+            return -1;
+        if(result == 0)
+            break;
+        done += result;
+    }
+    return done;
+}
+
+static void* reader_thread(void* arg) {
+    block_reader* reader = (block_reader*)arg;
+
+    for(long long block = 0; block < reader->num_blocks; block++) {
+        int slot = (int)(block % PIPELINE_QUEUE_DEPTH);
+
+        pthread_mutex_lock(&reader->lock);
+        while(!reader->stop && block >= reader->released + PIPELINE_QUEUE_DEPTH)
+            pthread_cond_wait(&reader->cond, &reader->lock);
+        int stop = reader->stop;
+        pthread_mutex_unlock(&reader->lock);
+        if(stop)
+            break;
+
+        long long length = read_fully(reader->fd, reader->buffers[slot], block_length(reader, block),
+                                      block * PIPELINE_BLOCK_SIZE);
+
+        pthread_mutex_lock(&reader->lock);
+        reader->lengths[slot] = length;
+        reader->ready[slot] = 1;
+        pthread_cond_broadcast(&reader->cond);
+        pthread_mutex_unlock(&reader->lock);
+
+        if(length < 0)
+            break;
+    }
+    return NULL;
+}
+
+#ifdef ID3_HAVE_LIBURING
+static int uring_submit_block(block_reader* reader, long long block) {
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&reader->ring);
+    if(sqe == NULL)
+        return -1;
+
+    int slot = (int)(block % PIPELINE_QUEUE_DEPTH);
+    io_uring_prep_read(sqe, reader->fd, reader->buffers[slot], (unsigned)block_length(reader, block),
+                       (unsigned long long)block * PIPELINE_BLOCK_SIZE);
+    io_uring_sqe_set_data(sqe, (void*)(uintptr_t)slot);
+    if(io_uring_submit(&reader->ring) < 1)
+        return -1;
+
+    reader->in_flight++;
+    return 0;
+}
+
+// Reaps one completion into its slot
+static int uring_reap(block_reader* reader) {
+    struct io_uring_cqe* cqe;
+    if(io_uring_wait_cqe(&reader->ring, &cqe) != 0)
+        return -1;
+
+    int slot = (int)(uintptr_t)io_uring_cqe_get_data(cqe);
+    reader->lengths[slot] = cqe->res < 0 ? -1 : cqe->res;
+    reader->ready[slot] = 1;
+    reader->in_flight--;
+    io_uring_cqe_seen(&reader->ring, cqe);
+    return 0;
+}
+#endif
+
+static block_reader* reader_open(const char* path) {
+    block_reader* reader = (block_reader*)calloc(1, sizeof(block_reader));
+    if(reader == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+
+    struct stat info;
+    reader->fd = open(path, O_RDONLY);
+    if(reader->fd < 0 || fstat(reader->fd, &info) != 0) {
+        perror("Error opening file");
+        if(reader->fd >= 0)
+            close(reader->fd);
+        free(reader);
+        return NULL;
+    }
+    posix_fadvise(reader->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    reader->file_size = info.st_size;
+    reader->num_blocks = (reader->file_size + PIPELINE_BLOCK_SIZE - 1) / PIPELINE_BLOCK_SIZE;
+    reader->current = -1;
+
+    for(int i = 0; i < PIPELINE_QUEUE_DEPTH; i++) {
+        reader->buffers[i] = (char*)malloc(PIPELINE_BLOCK_SIZE);
+        if(reader->buffers[i] == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            for(int j = 0; j < i; j++)
+                free(reader->buffers[j]);
+            close(reader->fd);
+            free(reader);
+            return NULL;
+        }
+    }
+
+    reader->backend = READER_SYNC;
+
+#ifdef ID3_HAVE_LIBURING
+    // io_uring may be missing or forbidden at run time: fall back to the reader thread
+    if(io_uring_queue_init(PIPELINE_QUEUE_DEPTH, &reader->ring, 0) == 0) {
+        reader->backend = READER_URING;
+        for(long long block = 0; block < reader->num_blocks && block < PIPELINE_QUEUE_DEPTH; block++) {
+            if(uring_submit_block(reader, block) != 0) {
+                // completions already queued are drained by reader_close
+                reader->lengths[block] = -1;
+                reader->ready[block] = 1;
+                break;
+            }
+        }
+        return reader;
+    }
+#endif
+
+    pthread_mutex_init(&reader->lock, NULL);
+    pthread_cond_init(&reader->cond, NULL);
+    if(pthread_create(&reader->thread, NULL, reader_thread, reader) == 0)
+        reader->backend = READER_THREAD;
+
+    return reader;
+}
+
+// Releases the previous block and returns the next one in data
+// Returns its length, 0 at end of file, -1 on error
+static long long reader_next(block_reader* reader, const char** data) {
+    if(reader->current >= 0) {
+        int slot = (int)(reader->current % PIPELINE_QUEUE_DEPTH);
+        if(reader->backend == READER_THREAD) {
+            pthread_mutex_lock(&reader->lock);
+            reader->ready[slot] = 0;
+            reader->released = reader->current + 1;
+            pthread_cond_broadcast(&reader->cond);
+            pthread_mutex_unlock(&reader->lock);
+        } else {
+            reader->ready[slot] = 0;
+        }
+
+#ifdef ID3_HAVE_LIBURING
+        long long refill = reader->current + PIPELINE_QUEUE_DEPTH;
+        if(reader->backend == READER_URING && refill < reader->num_blocks && uring_submit_block(reader, refill) != 0) {
+            reader->lengths[slot] = -1;
+            reader->ready[slot] = 1;
+        }
+#endif
+    }
+
+    reader->current++;
+    if(reader->current >= reader->num_blocks)
+        return 0;
+
+    int slot = (int)(reader->current % PIPELINE_QUEUE_DEPTH);
+    long long expected = block_length(reader, reader->current);
+    long long offset = reader->current * PIPELINE_BLOCK_SIZE;
+
+    if(reader->backend == READER_THREAD) {
+        pthread_mutex_lock(&reader->lock);
+        while(!reader->ready[slot])
+            pthread_cond_wait(&reader->cond, &reader->lock);
+        pthread_mutex_unlock(&reader->lock);
+    } else if(reader->backend == READER_SYNC) {
+        reader->lengths[slot] = read_fully(reader->fd, reader->buffers[slot], expected, offset);
+        reader->ready[slot] = 1;
+    }
+#ifdef ID3_HAVE_LIBURING
+    else {
+        while(!reader->ready[slot]) {
+            if(uring_reap(reader) != 0) {
+                reader->lengths[slot] = -1;
+                break;
+            }
+        }
+        // short read: finish the block synchronously
+        long long length = reader->lengths[slot];
+        if(length >= 0 && length < expected) {
+            long long rest = read_fully(reader->fd, reader->buffers[slot] + length, expected - length, offset + length);
+            reader->lengths[slot] = rest < 0 ? -1 : length + rest;
+        }
+    }
+#endif
+
+    *data = reader->buffers[slot];
+    return reader->lengths[slot];
+}
+
+static void reader_close(block_reader* reader) {
+    if(reader->backend == READER_THREAD) {
+        pthread_mutex_lock(&reader->lock);
+        reader->stop = 1;
+        pthread_cond_broadcast(&reader->cond);
+        pthread_mutex_unlock(&reader->lock);
+        pthread_join(reader->thread, NULL);
+    }
+    if(reader->backend != READER_URING) {
+        pthread_mutex_destroy(&reader->lock);
+        pthread_cond_destroy(&reader->cond);
+    }
+
+#ifdef ID3_HAVE_LIBURING
+    // the kernel may still write into the buffers until every read completed
+    if(reader->backend == READER_URING) {
+        while(reader->in_flight > 0 && uring_reap(reader) == 0)
+            ;
+        io_uring_queue_exit(&reader->ring);
+    }
+#endif
+
+    for(int i = 0; i < PIPELINE_QUEUE_DEPTH; i++)
+        free(reader->buffers[i]);
+    close(reader->fd);
+    free(reader);
+}
+
+// splitmix64 finalizer (see synth.c): the split of a record only depends on seed and position
+static unsigned long long split_hash(unsigned long long seed, unsigned long long position) {
+    unsigned long long x = seed ^ (position * 0xD1B54A32D192ED03ULL);
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static int append_record(input_record** set, int* size, int* capacity, const input_record* record) {
+    if(*size == *capacity) {
+        if(*capacity > 0x3fffffff) {
+            fprintf(stderr, "Error at pipeline_load(): too many records.\n");
+            return -1;
+        }
+        int new_capacity = *capacity > 0 ? *capacity * 2 : 1024;
+        input_record* grown = (input_record*)realloc(*set, (size_t)new_capacity * sizeof(input_record));
+        if(grown == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            return -1;
+        }
+        *set = grown;
+        *capacity = new_capacity;
+    }
+
+    (*set)[(*size)++] = *record;
+    return 0;
+}
+
+// Assigns a parsed record to the training or testing set; training records are counted
+static int add_record(pipeline_state* state, const input_record* record) {
+    if(split_hash(state->seed, (unsigned long long)state->position++) >= state->train_threshold)
+        return append_record(&state->testing_set, &state->test_size, &state->test_capacity, record);
+
+    if(state->collapser != NULL) {
+        if(input_collapser_add(state->collapser, record) != 0)
+            return -1;
+    } else if(append_record(&state->training_set, &state->train_size, &state->train_capacity, record) != 0) {
+        return -1;
+    }
+
+    long long* counts = state->counts;
+    ID3_CLASS_COUNT(counts, record->label)++;
+    for(int j = 0; j < NUM_ATTRIBUTES; j++)
+        ID3_ATTR_COUNT(counts, j, record->attributes[j], record->label)++;
+    return 0;
+}
+
+// Parses one text line [p, end) (without its newline)
+static int parse_line(pipeline_state* state, const char* p, const char* end) {
+    state->lineno++;
+
+    input_record record;
+    input_parse_status status = input_parse_line(p, end, &record);
+    if(status == INPUT_PARSE_BLANK)
+        return 0;
+    if(status != INPUT_PARSE_OK) {
+        input_print_parse_error("pipeline_load", status, p, end, state->lineno);
+        return -1;
+    }
+
+    return add_record(state, &record);
+}
+
+static int parse_text_block(pipeline_state* state, const char* data, long long length) {
+    const char* p = data;
+    const char* end = data + length;
+
+    // finish the line left over by the previous block
+    if(state->carry_length > 0) {
+        const char* newline = (const char*)memchr(p, '\n', (size_t)length);
+        long long take = newline != NULL ? newline - p : length;
+        if(state->carry_length + take > INPUT_MAX_LINE) {
+            fprintf(stderr, "Error at pipeline_load(): line %lld is too long.\n", state->lineno + 1);
+            return -1;
+        }
+        memcpy(state->carry + state->carry_length, p, (size_t)take);
+        state->carry_length += (int)take;
+        if(newline == NULL)
+            return 0;
+
+        if(parse_line(state, state->carry, state->carry + state->carry_length) != 0)
+            return -1;
+        state->carry_length = 0;
+        p = newline + 1;
+    }
+
+    while(p < end) {
+        const char* newline = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if(newline == NULL) {
+            if(end - p > INPUT_MAX_LINE) {
+                fprintf(stderr, "Error at pipeline_load(): line %lld is too long.\n", state->lineno + 1);
+                return -1;
+            }
+            memcpy(state->carry, p, (size_t)(end - p));
+            state->carry_length = (int)(end - p);
+            break;
+        }
+
+        if(parse_line(state, p, newline) != 0)
+            return -1;
+        p = newline + 1;
+    }
+    return 0;
+}
+
+// Validates the binary header (see input.h); returns the header size, -1 on error
+static int parse_binary_header(pipeline_state* state, const char* data, long long length, long long file_size) {
+    if(length < INPUT_BINARY_HEADER_SIZE) {
+        fprintf(stderr, "Error at pipeline_load(): invalid header.\n");
+        return -1;
+    }
+
+    unsigned long long count = input_decode_binary_header((const unsigned char*)data, "pipeline_load");
+    if(count == 0)
+        return -1;
+    if((unsigned long long)(file_size - INPUT_BINARY_HEADER_SIZE) < count * INPUT_BINARY_RECORD_SIZE) {
+        fprintf(stderr, "Error at pipeline_load(): truncated file.\n");
+        return -1;
+    }
+
+    state->binary_remaining = (long long)count;
+    return INPUT_BINARY_HEADER_SIZE;
+}
+
+static int parse_binary_block(pipeline_state* state, const char* data, long long length) {
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + length;
+    input_record record;
+
+    // finish the record left over by the previous block
+    if(state->carry_length > 0 && state->binary_remaining > 0) {
+        int take = INPUT_BINARY_RECORD_SIZE - state->carry_length;
+        if(take > end - p)
+            take = (int)(end - p);
+        memcpy(state->carry + state->carry_length, p, (size_t)take);
+        state->carry_length += take;
+        p += take;
+        if(state->carry_length < INPUT_BINARY_RECORD_SIZE)
+            return 0;
+
+        input_unpack_record((const unsigned char*)state->carry, &record);
+        if(add_record(state, &record) != 0)
+            return -1;
+        state->carry_length = 0;
+        state->binary_remaining--;
+    }
+
+    while(state->binary_remaining > 0 && end - p >= INPUT_BINARY_RECORD_SIZE) {
+        input_unpack_record(p, &record);
+        if(add_record(state, &record) != 0)
+            return -1;
+        p += INPUT_BINARY_RECORD_SIZE;
+        state->binary_remaining--;
+    }
+
+    if(state->binary_remaining > 0 && p < end) {
+        memcpy(state->carry, p, (size_t)(end - p));
+        state->carry_length = (int)(end - p);
+    }
+    return 0;
+}
+
+// Presizes the training/testing sets from an estimate of the number of records
+// (no training set when collapsing)
+static int reserve_sets(pipeline_state* state, long long estimate) {
+    if(estimate > 0x7fffffffLL)
+        estimate = 0x7fffffffLL;
+
+    double train_estimate = estimate * TRAINING_SET_RATIO * PIPELINE_CAPACITY_SLACK;
+    double test_estimate = estimate * (1.0 - TRAINING_SET_RATIO) * PIPELINE_CAPACITY_SLACK;
+    state->train_capacity = (int)(train_estimate < 0x3fffffff ? train_estimate : 0x3fffffff) + 1024;
+    state->test_capacity = (int)(test_estimate < 0x3fffffff ? test_estimate : 0x3fffffff) + 1024;
+
+    if(state->collapser != NULL)
+        state->train_capacity = 0;
+    else
+        state->training_set = (input_record*)malloc((size_t)state->train_capacity * sizeof(input_record));
+    state->testing_set = (input_record*)malloc((size_t)state->test_capacity * sizeof(input_record));
+    if((state->collapser == NULL && state->training_set == NULL) || state->testing_set == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+ID3_problem* pipeline_load(const char* path, unsigned long long seed, int collapse, long long** root_counts, int* test_size) {
+    *root_counts = NULL;
+    *test_size = 0;
+
+    block_reader* reader = reader_open(path);
+    if(reader == NULL)
+        return NULL;
+
+    pipeline_state state;
+    memset(&state, 0, sizeof(state));
+    state.seed = seed;
+    state.train_threshold = (unsigned long long)(TRAINING_SET_RATIO * 18446744073709551616.0);
+    state.counts = (long long*)calloc(ID3_COUNTS_SIZE, sizeof(long long));
+    if(collapse)
+        state.collapser = input_collapser_create();
+
+    int status = state.counts != NULL && (!collapse || state.collapser != NULL) ? 0 : -1;
+    long long block = 0;
+    while(status == 0) {
+        const char* data = NULL;
+        long long length = reader_next(reader, &data);
+        if(length <= 0) {
+            if(length < 0) {
+                perror("Error reading file");
+                status = -1;
+            }
+            break;
+        }
+
+        TRACE_START(load_start);
+        long long before = state.position;
+        (void)before;   // only read by TRACE_STOP
+
+        // the first block decides the format and the initial capacities
+        if(block++ == 0) {
+            state.binary = length >= 4 && memcmp(data, INPUT_BINARY_MAGIC, 4) == 0;
+            int skip = 0;
+            if(state.binary) {
+                skip = parse_binary_header(&state, data, length, reader->file_size);
+                status = skip < 0 ? -1 : reserve_sets(&state, state.binary_remaining);
+            } else {
+                status = reserve_sets(&state, reader->file_size / INPUT_MIN_LINE + 1);
+            }
+            data += skip > 0 ? skip : 0;
+            length -= skip > 0 ? skip : 0;
+        }
+
+        if(status == 0)
+            status = state.binary ? parse_binary_block(&state, data, length)
+                                  : parse_text_block(&state, data, length);
+
+        TRACE_STOP(load_start, TRACE_LOAD, 0, state.position - before);
+    }
+
+    reader_close(reader);
+
+    // last line without a newline
+    if(status == 0 && !state.binary && state.carry_length > 0)
+        status = parse_line(&state, state.carry, state.carry + state.carry_length);
+
+    if(status == 0 && state.binary && state.binary_remaining > 0) {
+        fprintf(stderr, "Error at pipeline_load(): truncated file.\n");
+        status = -1;
+    }
+    if(status == 0 && state.position == 0) {
+        fprintf(stderr, "Error at pipeline_load(): no valid records found.\n");
+        status = -1;
+    }
+
+    // distinct training records, weighted by their number of occurrences
+    long long* weights = NULL;
+    if(status == 0 && state.collapser != NULL) {
+        state.training_set = input_collapser_finish(state.collapser, &state.train_size, &weights);
+        state.train_capacity = state.train_size;
+        state.collapser = NULL;
+    }
+
+    ID3_problem* problem = NULL;
+    if(status == 0)
+        problem = ID3_create_problem(NULL, state.training_set, state.testing_set, TRAINING_SET_RATIO);
+
+    if(problem == NULL) {
+        input_collapser_free(state.collapser);
+        free(state.training_set);
+        free(state.testing_set);
+        free(state.counts);
+        free(weights);
+        return NULL;
+    }
+
+    problem->training_set_size = state.train_size;
+    problem->training_set_capacity = state.train_capacity;
+    problem->training_weights = weights;
+    *root_counts = state.counts;
+    *test_size = state.test_size;
+    return problem;
+}
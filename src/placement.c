@@ -0,0 +1,151 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include <placement.h>
+
+#define PLACEMENT_SYSFS_NODES "/sys/devices/system/node"
+
+static placement_topology topology;
+static pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+
+// Parses a sysfs CPU/node list ("0-3,8,10-11") into set; returns 0 on success
+static int parse_list(const char* path, cpu_set_t* set) {
+    FILE* file = fopen(path, "r");
+    if(file == NULL)
+        return -1;
+
+    char buffer[4096];
+    char* text = fgets(buffer, sizeof(buffer), file);
+    fclose(file);
+    if(text == NULL)
+        return -1;
+
+    CPU_ZERO(set);
+    while(*text != '\0' && *text != '\n') {
+        char* end;
+        long first = strtol(text, &end, 10);
+        if(end == text)
+            return -1;
+        long last = first;
+        if(*end == '-') {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+            if(end == text)
+                return -1;
+        }
+        for(long i = first; i <= last && i < CPU_SETSIZE; i++)
+            CPU_SET((int)i, set);
+
+        text = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+}
+
+static void add_node(int node_id, const cpu_set_t* cpus, const cpu_set_t* allowed) {
+    if(topology.num_nodes == PLACEMENT_MAX_NODES)
+        return;
+
+    int offset = topology.node_offsets[topology.num_nodes];
+    int count = 0;
+    for(int cpu = 0; cpu < CPU_SETSIZE && offset + count < PLACEMENT_MAX_CPUS; cpu++) {
+        if(CPU_ISSET(cpu, cpus) && CPU_ISSET(cpu, allowed))
+            topology.cpus[offset + count++] = cpu;
+    }
+
+    // nodes without allowed CPUs (memory-only, or outside the affinity mask) are skipped
+    if(count == 0)
+        return;
+
+    topology.node_ids[topology.num_nodes] = node_id;
+    topology.node_offsets[++topology.num_nodes] = offset + count;
+}
+
+static void detect_topology(void) {
+    cpu_set_t allowed;
+    if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        CPU_ZERO(&allowed);
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        for(long cpu = 0; cpu < (online > 0 ? online : 1) && cpu < CPU_SETSIZE; cpu++)
+            CPU_SET((int)cpu, &allowed);
+    }
+
+    memset(&topology, 0, sizeof(topology));
+
+    cpu_set_t nodes;
+    if(parse_list(PLACEMENT_SYSFS_NODES "/online", &nodes) == 0) {
+        for(int node = 0; node < CPU_SETSIZE; node++) {
+            if(!CPU_ISSET(node, &nodes))
+                continue;
+
+            char path[128];
+            cpu_set_t cpus;
+            snprintf(path, sizeof(path), PLACEMENT_SYSFS_NODES "/node%d/cpulist", node);
+            if(parse_list(path, &cpus) == 0)
+                add_node(node, &cpus, &allowed);
+        }
+    }
+
+    // no NUMA information: one node with every allowed CPU
+    if(topology.num_nodes == 0)
+        add_node(0, &allowed, &allowed);
+
+    // not even the affinity mask (should not happen): CPU 0
+    if(topology.num_nodes == 0) {
+        topology.num_nodes = 1;
+        topology.node_offsets[1] = 1;
+        topology.cpus[0] = 0;
+    }
+}
+
+const placement_topology* placement_get_topology(void) {
+    pthread_once(&topology_once, detect_topology);
+    return &topology;
+}
+
+int placement_worker_node(int worker) {
+    const placement_topology* topo = placement_get_topology();
+    return (worker < 0 ? 0 : worker) % topo->num_nodes;
+}
+
+int placement_worker_cpu(int worker) {
+    const placement_topology* topo = placement_get_topology();
+    int node = placement_worker_node(worker);
+    int first = topo->node_offsets[node];
+    int count = topo->node_offsets[node + 1] - first;
+    return topo->cpus[first + ((worker < 0 ? 0 : worker) / topo->num_nodes) % count];
+}
+
+int placement_create_thread(pthread_t* thread, void* (*start)(void*), void* arg, int worker) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(placement_worker_cpu(worker), &set);
+
+    pthread_attr_t attr;
+    if(pthread_attr_init(&attr) == 0) {
+        int status = -1;
+        if(pthread_attr_setaffinity_np(&attr, sizeof(set), &set) == 0)
+            status = pthread_create(thread, &attr, start, arg);
+        pthread_attr_destroy(&attr);
+        if(status == 0)
+            return 0;
+    }
+
+    return pthread_create(thread, NULL, start, arg) == 0 ? 0 : -1;
+}
+
+size_t placement_touch_slice(size_t size, int num_workers) {
+    long page = sysconf(_SC_PAGESIZE);
+    if(page <= 0)
+        page = 4096;
+
+    if(num_workers <= 1 || size < (size_t)page * num_workers)
+        return 0;
+
+    // page-aligned slices: a page is never shared by two workers
+    size_t slice = (size + num_workers - 1) / num_workers;
+    return (slice + page - 1) / page * page;
+}
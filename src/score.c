@@ -0,0 +1,460 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <score.h>
+#include <input.h>
+#include <ID3.h>
+#include <placement.h>
+
+// Bytes of text read per chunk
+#define SCORE_TEXT_CHUNK_SIZE ((long long)SCORE_BATCH_RECORDS * INPUT_MIN_LINE)
+
+// Longest output line
+#define SCORE_MAX_LABEL_LENGTH 11
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_FILLED,  // waiting for a worker
+    SLOT_DONE     // labels ready to be written
+} slot_state;
+
+// One chunk of input and its output
+typedef struct score_slot {
+    char*         input;
+    long long     input_length;
+    char*         output;
+    long long     output_length;
+    long long     num_records;
+    long long     num_lines;    // text lines of the chunk
+    long long     error_line;   // line (in the chunk) of an invalid record, 0 if none
+    const char*   error_start;  // that line, without its newline
+    const char*   error_end;
+    int           error_status; // input_parse_status of that line
+    int           failed;       // the worker had no scratch memory
+    int           binary;
+    slot_state    state;
+} score_slot;
+
+typedef enum {
+    REPLICA_NONE,
+    REPLICA_BUILDING,
+    REPLICA_READY
+} replica_state;
+
+// Chunk k lives in slot k % num_slots
+// With numa, each NUMA node gets a copy of the tree made by its first worker
+typedef struct score_queue {
+    const ID3_compact_tree* tree;
+    int                     numa;
+    ID3_compact_tree*       replicas[PLACEMENT_MAX_NODES];
+    replica_state           replica_states[PLACEMENT_MAX_NODES];
+    score_slot*      slots;
+    int              num_slots;
+    long long        num_filled;   // chunks handed to the workers
+    long long        next_chunk;   // next chunk a worker takes
+    int              stop;
+    pthread_mutex_t  lock;
+    pthread_cond_t   cond;
+} score_queue;
+
+// Argument of a worker thread
+typedef struct score_worker_arg {
+    score_queue* queue;
+    int          worker;
+} score_worker_arg;
+
+static const long long input_capacity =
+    SCORE_TEXT_CHUNK_SIZE + INPUT_MAX_LINE > (long long)SCORE_BATCH_RECORDS * INPUT_BINARY_RECORD_SIZE
+    ? SCORE_TEXT_CHUNK_SIZE + INPUT_MAX_LINE : (long long)SCORE_BATCH_RECORDS * INPUT_BINARY_RECORD_SIZE;
+
+// Records a chunk can hold (size of the parsing scratch)
+static long long record_capacity(void) {
+    long long capacity = input_capacity / INPUT_MIN_LINE + 1;
+    return capacity > SCORE_BATCH_RECORDS ? capacity : SCORE_BATCH_RECORDS;
+}
+
+// Parses a chunk into records, classifies them into labels and formats the output
+static void process_slot(const ID3_compact_tree* tree, score_slot* slot, input_record* records, int* labels) {
+    long long count = 0;
+    slot->num_lines = 0;
+    slot->error_line = 0;
+    slot->failed = records == NULL || labels == NULL;
+    if(slot->failed) {
+        slot->output_length = 0;
+        return;
+    }
+
+    if(slot->binary) {
+        const unsigned char* p = (const unsigned char*)slot->input;
+        count = slot->input_length / INPUT_BINARY_RECORD_SIZE;
+        for(long long i = 0; i < count; i++)
+            input_unpack_record(p + i * INPUT_BINARY_RECORD_SIZE, &records[i]);
+    } else {
+        const char* p = slot->input;
+        const char* end = slot->input + slot->input_length;
+        while(p < end) {
+            const char* newline = (const char*)memchr(p, '\n', (size_t)(end - p));
+            const char* line_end = newline != NULL ? newline : end;
+            slot->num_lines++;
+
+            input_parse_status status = input_parse_line(p, line_end, &records[count]);
+            if(status == INPUT_PARSE_OK) {
+                count++;
+            } else if(status != INPUT_PARSE_BLANK) {
+                slot->error_line = slot->num_lines;
+                slot->error_start = p;
+                slot->error_end = line_end;
+                slot->error_status = status;
+                break;
+            }
+            p = newline != NULL ? newline + 1 : end;
+        }
+    }
+    slot->num_records = count;
+
+    ID3_predict_compact(tree, records, (int)count, labels);
+
+    char* out = slot->output;
+    for(long long i = 0; i < count; i++) {
+        if(labels[i] == REPUBLICAN) {
+            memcpy(out, "republican\n", 11);
+            out += 11;
+        } else {
+            memcpy(out, "democrat\n", 9);
+            out += 9;
+        }
+    }
+    slot->output_length = out - slot->output;
+}
+
+// Tree replica of a NUMA node, copied by the first worker of the node
+// (the shared tree if the copy fails)
+static const ID3_compact_tree* node_replica(score_queue* queue, int node) {
+    pthread_mutex_lock(&queue->lock);
+    while(queue->replica_states[node] == REPLICA_BUILDING)
+        pthread_cond_wait(&queue->cond, &queue->lock);
+
+    if(queue->replica_states[node] == REPLICA_NONE) {
+        queue->replica_states[node] = REPLICA_BUILDING;
+        pthread_mutex_unlock(&queue->lock);
+
+        ID3_compact_tree* replica = ID3_compact_tree_clone(queue->tree);
+
+        pthread_mutex_lock(&queue->lock);
+        queue->replicas[node] = replica;
+        queue->replica_states[node] = REPLICA_READY;
+        pthread_cond_broadcast(&queue->cond);
+    }
+
+    const ID3_compact_tree* tree = queue->replicas[node] != NULL ? queue->replicas[node] : queue->tree;
+    pthread_mutex_unlock(&queue->lock);
+    return tree;
+}
+
+static void* score_worker(void* arg) {
+    score_queue* queue = ((score_worker_arg*)arg)->queue;
+    int worker = ((score_worker_arg*)arg)->worker;
+
+    // allocated (and first written) by this thread: node-local when pinned
+    long long capacity = record_capacity();
+    input_record* records = (input_record*)malloc((size_t)capacity * sizeof(input_record));
+    int* labels = (int*)malloc((size_t)capacity * sizeof(int));
+    const ID3_compact_tree* tree = queue->numa ? node_replica(queue, placement_worker_node(worker)) : queue->tree;
+
+    pthread_mutex_lock(&queue->lock);
+    while(1) {
+        while(!queue->stop && queue->next_chunk >= queue->num_filled)
+            pthread_cond_wait(&queue->cond, &queue->lock);
+        if(queue->stop)
+            break;
+
+        score_slot* slot = &queue->slots[queue->next_chunk++ % queue->num_slots];
+        pthread_mutex_unlock(&queue->lock);
+
+        process_slot(tree, slot, records, labels);
+
+        pthread_mutex_lock(&queue->lock);
+        slot->state = SLOT_DONE;
+        pthread_cond_broadcast(&queue->cond);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    free(records);
+    free(labels);
+    return NULL;
+}
+
+static void free_slots(score_slot* slots, int num_slots) {
+    for(int i = 0; i < num_slots; i++) {
+        free(slots[i].input);
+        free(slots[i].output);
+    }
+    free(slots);
+}
+
+static score_slot* create_slots(int num_slots) {
+    score_slot* slots = (score_slot*)calloc(num_slots, sizeof(score_slot));
+    if(slots == NULL)
+        return NULL;
+
+    for(int i = 0; i < num_slots; i++) {
+        slots[i].input = (char*)malloc((size_t)input_capacity);
+        slots[i].output = (char*)malloc((size_t)record_capacity() * SCORE_MAX_LABEL_LENGTH);
+        if(slots[i].input == NULL || slots[i].output == NULL) {
+            free_slots(slots, num_slots);
+            return NULL;
+        }
+    }
+    return slots;
+}
+
+// Reads and validates a binary header whose magic (first 4 bytes) was already read
+// Returns the number of records of the batch, -1 on error
+static long long read_binary_header(FILE* in, const char* magic) {
+    unsigned char header[INPUT_BINARY_HEADER_SIZE];
+    memcpy(header, magic, 4);
+    if(fread(header + 4, 1, sizeof(header) - 4, in) != sizeof(header) - 4) {
+        fprintf(stderr, "Error at score_stream(): invalid header.\n");
+        return -1;
+    }
+
+    unsigned long long count = input_decode_binary_header(header, "score_stream");
+    return count > 0 ? (long long)count : -1;
+}
+
+// Reading state of the calling thread
+typedef struct score_reader {
+    FILE*     in;
+    int       binary;
+    long long batch_remaining;  // binary: records left in the current batch
+    char      carry[INPUT_MAX_LINE + 4];  // text: partial line read with the previous chunk
+    int       carry_length;
+    int       eof;
+} score_reader;
+
+// Fills slot with the next chunk; returns 1 if filled, 0 at end of input, -1 on error
+static int read_chunk(score_reader* reader, score_slot* slot) {
+    slot->binary = reader->binary;
+
+    if(reader->binary) {
+        while(reader->batch_remaining == 0) {
+            // next batch: another header or the end of the stream
+            char magic[4];
+            size_t got = fread(magic, 1, sizeof(magic), reader->in);
+            if(got == 0)
+                return 0;
+            if(got != sizeof(magic) || memcmp(magic, INPUT_BINARY_MAGIC, 4) != 0) {
+                fprintf(stderr, "Error at score_stream(): invalid header.\n");
+                return -1;
+            }
+            reader->batch_remaining = read_binary_header(reader->in, magic);
+            if(reader->batch_remaining < 0)
+                return -1;
+        }
+
+        long long count = reader->batch_remaining < SCORE_BATCH_RECORDS ? reader->batch_remaining : SCORE_BATCH_RECORDS;
+        size_t bytes = (size_t)count * INPUT_BINARY_RECORD_SIZE;
+        if(fread(slot->input, 1, bytes, reader->in) != bytes) {
+            fprintf(stderr, "Error at score_stream(): truncated batch.\n");
+            return -1;
+        }
+        slot->input_length = (long long)bytes;
+        reader->batch_remaining -= count;
+        return 1;
+    }
+
+    while(!reader->eof) {
+        memcpy(slot->input, reader->carry, (size_t)reader->carry_length);
+        long long length = reader->carry_length;
+        length += (long long)fread(slot->input + length, 1, (size_t)SCORE_TEXT_CHUNK_SIZE, reader->in);
+        if(ferror(reader->in)) {
+            perror("Error reading input");
+            return -1;
+        }
+
+        // end of input: the chunk ends with the last line, newline or not
+        if(length < reader->carry_length + SCORE_TEXT_CHUNK_SIZE) {
+            reader->eof = 1;
+            reader->carry_length = 0;
+            slot->input_length = length;
+            return length > 0 ? 1 : 0;
+        }
+
+        // the chunk ends after its last newline, the rest is carried over
+        long long cut = length;
+        while(cut > 0 && slot->input[cut - 1] != '\n')
+            cut--;
+        if(length - cut > INPUT_MAX_LINE) {
+            fprintf(stderr, "Error at score_stream(): line too long.\n");
+            return -1;
+        }
+
+        reader->carry_length = (int)(length - cut);
+        memcpy(reader->carry, slot->input + cut, (size_t)reader->carry_length);
+        if(cut > 0) {
+            slot->input_length = cut;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Writes a processed chunk; returns 0 on success, -1 on error
+static int write_chunk(const score_slot* slot, FILE* out, long long* lines_before, long long* scored) {
+    if(slot->failed) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    if(slot->error_line > 0) {
+        input_print_parse_error("score_stream", (input_parse_status)slot->error_status, slot->error_start, slot->error_end,
+                                *lines_before + slot->error_line);
+        return -1;
+    }
+    if(slot->output_length > 0 && fwrite(slot->output, 1, (size_t)slot->output_length, out) != (size_t)slot->output_length) {
+        perror("Error writing output");
+        return -1;
+    }
+
+    *lines_before += slot->num_lines;
+    *scored += slot->num_records;
+    return 0;
+}
+
+long long score_stream(const tree_node* root, FILE* in, FILE* out, int num_threads, int numa) {
+    if(root == NULL || in == NULL || out == NULL) {
+        fprintf(stderr, "Error at score_stream(): invalid arguments.\n");
+        return -1;
+    }
+    if(num_threads > SCORE_MAX_THREADS)
+        num_threads = SCORE_MAX_THREADS;
+
+    score_reader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.in = in;
+
+    // format detection on the first bytes
+    size_t got = fread(reader.carry, 1, 4, in);
+    if(got == 4 && memcmp(reader.carry, INPUT_BINARY_MAGIC, 4) == 0) {
+        reader.binary = 1;
+        reader.batch_remaining = read_binary_header(in, reader.carry);
+        if(reader.batch_remaining < 0)
+            return -1;
+    } else {
+        reader.carry_length = (int)got;
+    }
+
+    score_queue queue;
+    memset(&queue, 0, sizeof(queue));
+    queue.tree = ID3_compact_tree_create(root);
+    queue.numa = numa;
+    queue.num_slots = num_threads > 1 ? 2 * num_threads : 1;
+    queue.slots = create_slots(queue.num_slots);
+    if(queue.tree == NULL || queue.slots == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        ID3_compact_tree_free((ID3_compact_tree*)queue.tree);
+        if(queue.slots != NULL)
+            free_slots(queue.slots, queue.num_slots);
+        return -1;
+    }
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.cond, NULL);
+
+    pthread_t threads[SCORE_MAX_THREADS];
+    score_worker_arg args[SCORE_MAX_THREADS];
+    int num_started = 0;
+    for(int t = 0; t < num_threads && num_threads > 1; t++) {
+        args[t].queue = &queue;
+        args[t].worker = t;
+        int status = numa ? placement_create_thread(&threads[t], score_worker, &args[t], t)
+                          : pthread_create(&threads[t], NULL, score_worker, &args[t]);
+        if(status != 0)
+            break;
+        num_started++;
+    }
+
+    // scratch of the calling thread when no worker could be started
+    input_record* records = NULL;
+    int* labels = NULL;
+    if(num_started == 0) {
+        records = (input_record*)malloc((size_t)record_capacity() * sizeof(input_record));
+        labels = (int*)malloc((size_t)record_capacity() * sizeof(int));
+    }
+
+    long long lines_before = 0, scored = 0;
+    long long num_written = 0;
+    int status = 0;
+
+    while(status == 0) {
+        long long chunk = queue.num_filled;
+        score_slot* slot = &queue.slots[chunk % queue.num_slots];
+
+        // the slot's previous chunk goes out first (chunks are written in order)
+        if(chunk >= queue.num_slots) {
+            pthread_mutex_lock(&queue.lock);
+            while(slot->state != SLOT_DONE)
+                pthread_cond_wait(&queue.cond, &queue.lock);
+            pthread_mutex_unlock(&queue.lock);
+
+            status = write_chunk(slot, out, &lines_before, &scored);
+            slot->state = SLOT_FREE;
+            num_written++;
+            if(status != 0)
+                break;
+        }
+
+        int filled = read_chunk(&reader, slot);
+        if(filled <= 0) {
+            status = filled;
+            break;
+        }
+
+        if(num_started == 0) {
+            process_slot(queue.tree, slot, records, labels);
+            slot->state = SLOT_DONE;
+            queue.num_filled++;
+        } else {
+            pthread_mutex_lock(&queue.lock);
+            slot->state = SLOT_FILLED;
+            queue.num_filled++;
+            pthread_cond_broadcast(&queue.cond);
+            pthread_mutex_unlock(&queue.lock);
+        }
+    }
+
+    // remaining chunks, in order
+    while(status == 0 && num_written < queue.num_filled) {
+        score_slot* slot = &queue.slots[num_written % queue.num_slots];
+        pthread_mutex_lock(&queue.lock);
+        while(slot->state != SLOT_DONE)
+            pthread_cond_wait(&queue.cond, &queue.lock);
+        pthread_mutex_unlock(&queue.lock);
+
+        status = write_chunk(slot, out, &lines_before, &scored);
+        slot->state = SLOT_FREE;
+        num_written++;
+    }
+
+    pthread_mutex_lock(&queue.lock);
+    queue.stop = 1;
+    pthread_cond_broadcast(&queue.cond);
+    pthread_mutex_unlock(&queue.lock);
+    for(int t = 0; t < num_started; t++)
+        pthread_join(threads[t], NULL);
+
+    pthread_mutex_destroy(&queue.lock);
+    pthread_cond_destroy(&queue.cond);
+    free_slots(queue.slots, queue.num_slots);
+    for(int node = 0; node < PLACEMENT_MAX_NODES; node++)
+        ID3_compact_tree_free(queue.replicas[node]);
+    ID3_compact_tree_free((ID3_compact_tree*)queue.tree);
+    free(records);
+    free(labels);
+
+    if(status == 0 && fflush(out) != 0) {
+        perror("Error writing output");
+        status = -1;
+    }
+    return status == 0 ? scored : -1;
+}
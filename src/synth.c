@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <synth.h>
+
+// 16 random bits per attribute, 4 attributes per 64-bit word
+#define SYNTH_ATTR_WORDS ((NUM_ATTRIBUTES + 3) / 4)
+
+synth_params synth_default_params() {
+    synth_params params;
+    params.seed = SYNTH_DEFAULT_SEED;
+    params.yes_probability = SYNTH_DEFAULT_YES_PROBABILITY;
+    params.class_balance = SYNTH_DEFAULT_CLASS_BALANCE;
+    params.noise = SYNTH_DEFAULT_NOISE;
+    params.tree_depth = SYNTH_DEFAULT_TREE_DEPTH;
+    return params;
+}
+
+// splitmix64 finalizer: counter-based generator, one independent word per input
+static unsigned long long splitmix64(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Probability in [0, 1] to a threshold over `bits` random bits
+static unsigned long long probability_threshold(float probability, int bits) {
+    double scale = (double)(1ULL << bits);
+    if(probability <= 0.0f) return 0;
+    if(probability >= 1.0f) return 1ULL << bits;
+    return (unsigned long long)(probability * scale);
+}
+
+synth_generator* synth_create(const synth_params* params) {
+    if(params == NULL || params->tree_depth < 0 || params->tree_depth > NUM_ATTRIBUTES) {
+        fprintf(stderr, "Error at synth_create: invalid parameters.\n");
+        return NULL;
+    }
+
+    synth_generator* generator = (synth_generator*)malloc(sizeof(synth_generator));
+    if(generator == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+
+    int num_leaves = 1 << params->tree_depth;
+    int num_internal = num_leaves - 1;
+
+    generator->params = *params;
+    generator->split_attrs = (int*)malloc((num_internal > 0 ? num_internal : 1) * sizeof(int));
+    generator->leaf_labels = (int*)malloc(num_leaves * sizeof(int));
+    if(generator->split_attrs == NULL || generator->leaf_labels == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        synth_free(generator);
+        return NULL;
+    }
+
+    unsigned long long state = params->seed;
+
+    // internal nodes: random attribute not used by any ancestor
+    for(int k = 0; k < num_internal; k++) {
+        int used[NUM_ATTRIBUTES] = {0};
+        for(int ancestor = k; ancestor > 0; ) {
+            ancestor = (ancestor - 1) / 2;
+            used[generator->split_attrs[ancestor]] = 1;
+        }
+
+        int num_free = 0;
+        int free_attrs[NUM_ATTRIBUTES];
+        for(int a = 0; a < NUM_ATTRIBUTES; a++)
+            if(!used[a])
+                free_attrs[num_free++] = a;
+
+        generator->split_attrs[k] = free_attrs[splitmix64(state++) % num_free];
+    }
+
+    // leaves: the first round(balance * leaves) are REPUBLICAN, then shuffled (Fisher-Yates)
+    int num_republican = (int)(params->class_balance * num_leaves + 0.5f);
+    for(int i = 0; i < num_leaves; i++)
+        generator->leaf_labels[i] = i < num_republican ? REPUBLICAN : DEMOCRAT;
+    for(int i = num_leaves - 1; i > 0; i--) {
+        int j = (int)(splitmix64(state++) % (unsigned long long)(i + 1));
+        int tmp = generator->leaf_labels[i];
+        generator->leaf_labels[i] = generator->leaf_labels[j];
+        generator->leaf_labels[j] = tmp;
+    }
+
+    return generator;
+}
+
+void synth_free(synth_generator* generator) {
+    if(generator == NULL)
+        return;
+
+    free(generator->split_attrs);
+    free(generator->leaf_labels);
+    free(generator);
+}
+
+int synth_planted_label(const synth_generator* generator, const input_record* record) {
+    int depth = generator->params.tree_depth;
+    int k = 0;
+
+    for(int d = 0; d < depth; d++)
+        k = record->attributes[generator->split_attrs[k]] == YES ? 2 * k + 1 : 2 * k + 2;
+
+    return generator->leaf_labels[k - ((1 << depth) - 1)];
+}
+
+void synth_generate(const synth_generator* generator, unsigned long long first_row, int count, input_record* records) {
+    const synth_params* params = &generator->params;
+    unsigned long long yes_threshold = probability_threshold(params->yes_probability, 16);
+    unsigned long long noise_threshold = probability_threshold(params->noise, 32);
+    unsigned long long balance_threshold = probability_threshold(params->class_balance, 32);
+
+    for(int i = 0; i < count; i++) {
+        unsigned long long row_state = params->seed ^ ((first_row + i) * 0xD1B54A32D192ED03ULL);
+        input_record* record = &records[i];
+
+        for(int w = 0; w < SYNTH_ATTR_WORDS; w++) {
+            unsigned long long word = splitmix64(row_state + w);
+            for(int b = 0; b < 4 && 4 * w + b < NUM_ATTRIBUTES; b++)
+                record->attributes[4 * w + b] = ((word >> (16 * b)) & 0xFFFF) < yes_threshold ? YES : NO;
+        }
+
+        unsigned long long label_word = splitmix64(row_state + SYNTH_ATTR_WORDS);
+        int label;
+        if(params->tree_depth == 0) {
+            // no planted structure: labels follow the class balance directly
+            label = (label_word & 0xFFFFFFFFULL) < balance_threshold ? REPUBLICAN : DEMOCRAT;
+        } else {
+            label = synth_planted_label(generator, record);
+            if((label_word >> 32) < noise_threshold)
+                label = label == REPUBLICAN ? DEMOCRAT : REPUBLICAN;
+        }
+        record->label = label;
+    }
+}
+
+// Node paths ("1.2.1.") take 2 characters per level, and tree_depth <= NUM_ATTRIBUTES
+#define SYNTH_PATH_SIZE (NUM_ATTRIBUTES * 2 + 1)
+
+// path holds the path of node k (length 2 * depth), extended in place for its children
+static void print_tree_rec(const synth_generator* generator, int k, int depth, char* path, FILE* out) {
+    if(depth >= generator->params.tree_depth)
+        return;
+
+    for(int i = 0; i < 2; i++) {
+        // first child = YES branch, second child = NO branch
+        int child = 2 * k + 1 + i;
+        path[2 * depth] = (char)('1' + i);
+        path[2 * depth + 1] = '.';
+        path[2 * depth + 2] = '\0';
+
+        if(depth + 1 == generator->params.tree_depth) {
+            int leaf = child - ((1 << generator->params.tree_depth) - 1);
+            fprintf(out, "%s      LEAF: class=%s\n", path, class_label_to_string(generator->leaf_labels[leaf]));
+        } else {
+            fprintf(out, "%s      SPLIT on attribute %d\n", path, generator->split_attrs[child]);
+        }
+
+        print_tree_rec(generator, child, depth + 1, path, out);
+    }
+}
+
+void synth_print_tree(const synth_generator* generator, FILE* out) {
+    fprintf(out, "--------------------------------------------------\n");
+    fprintf(out, "Planted Tree Structure\n\n");
+
+    if(generator->params.tree_depth == 0)
+        fprintf(out, "      LEAF: class balance=%.3f\n", generator->params.class_balance);
+    else
+        fprintf(out, "      SPLIT on attribute %d\n", generator->split_attrs[0]);
+    char path[SYNTH_PATH_SIZE];
+    path[0] = '\0';
+    print_tree_rec(generator, 0, 0, path, out);
+
+    fprintf(out, "--------------------------------------------------\n");
+}
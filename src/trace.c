@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <trace.h>
+
+static const char* phase_names[TRACE_NUM_PHASES] = {
+    "load", "count", "split_search", "partition", "node_alloc", "predict"
+};
+
+typedef struct trace_event {
+    unsigned long long start;
+    unsigned long long end;
+    int                phase;
+    int                depth;
+    long long          items;
+} trace_event;
+
+// Events are kept in chunks allocated as the thread records them
+typedef struct trace_chunk {
+    trace_event         events[TRACE_EVENT_CHUNK];
+    int                 num_events;
+    struct trace_chunk* next;
+} trace_chunk;
+
+// Aggregated counters of one phase at one depth
+typedef struct trace_counter {
+    long long          calls;
+    long long          items;
+    unsigned long long ticks;
+} trace_counter;
+
+// Per-thread state: written only by its thread, read at export.
+// Never freed: a thread may still be recording while the exit handler exports.
+typedef struct trace_thread {
+    int                  tid;
+    trace_counter        counters[TRACE_NUM_PHASES][TRACE_MAX_DEPTH];
+    trace_chunk*         first_chunk;
+    trace_chunk*         last_chunk;
+    int                  num_events;
+    long long            dropped_events;
+    struct trace_thread* next;
+} trace_thread;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static trace_thread* trace_threads = NULL;
+static int trace_num_threads = 0;
+static unsigned long long base_ticks = 0;
+static unsigned long long base_ns = 0;
+static int trace_exported = 0;   // accessed atomically: read by every recording thread
+
+static __thread trace_thread* local_thread = NULL;
+
+// Updates a value only its thread writes (no read-modify-write needed), with an
+// atomic store so that an export running concurrently reads whole values
+#define TRACE_PUBLISH(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+#define TRACE_READ(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+static unsigned long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+unsigned long long trace_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return monotonic_ns();
+#endif
+}
+
+// Registers the calling thread (and the exit handler on first use)
+static trace_thread* trace_register_thread(void) {
+    trace_thread* thread = (trace_thread*)calloc(1, sizeof(trace_thread));
+    if(thread == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&trace_lock);
+    if(trace_threads == NULL && trace_num_threads == 0) {
+        base_ns = monotonic_ns();
+        base_ticks = trace_now();
+        atexit(trace_export);
+    }
+    thread->tid = trace_num_threads++;
+    thread->next = trace_threads;
+    trace_threads = thread;
+    pthread_mutex_unlock(&trace_lock);
+
+    return thread;
+}
+
+void trace_record(trace_phase phase, int depth, unsigned long long start, long long items) {
+    unsigned long long end = trace_now();
+
+    if(__atomic_load_n(&trace_exported, __ATOMIC_ACQUIRE))
+        return;
+
+    if(local_thread == NULL) {
+        local_thread = trace_register_thread();
+        if(local_thread == NULL)
+            return;
+    }
+
+    if(depth < 0) depth = 0;
+    if(depth >= TRACE_MAX_DEPTH) depth = TRACE_MAX_DEPTH - 1;
+
+    trace_counter* counter = &local_thread->counters[phase][depth];
+    TRACE_PUBLISH(counter->calls, counter->calls + 1);
+    TRACE_PUBLISH(counter->items, counter->items + items);
+    TRACE_PUBLISH(counter->ticks, counter->ticks + (end - start));
+
+    trace_chunk* chunk = local_thread->last_chunk;
+    if(local_thread->num_events < TRACE_MAX_EVENTS && (chunk == NULL || chunk->num_events == TRACE_EVENT_CHUNK)) {
+        chunk = (trace_chunk*)malloc(sizeof(trace_chunk));
+        if(chunk != NULL) {
+            chunk->num_events = 0;
+            chunk->next = NULL;
+            // published after initialisation: the exporter may walk the list concurrently
+            if(local_thread->last_chunk != NULL)
+                __atomic_store_n(&local_thread->last_chunk->next, chunk, __ATOMIC_RELEASE);
+            else
+                __atomic_store_n(&local_thread->first_chunk, chunk, __ATOMIC_RELEASE);
+            local_thread->last_chunk = chunk;
+        }
+    }
+
+    if(chunk != NULL && chunk->num_events < TRACE_EVENT_CHUNK && local_thread->num_events < TRACE_MAX_EVENTS) {
+        trace_event* event = &chunk->events[chunk->num_events];
+        local_thread->num_events++;
+        event->start = start;
+        event->end = end;
+        event->phase = phase;
+        event->depth = depth;
+        event->items = items;
+        // the exporter reads events [0, num_events) only
+        __atomic_store_n(&chunk->num_events, chunk->num_events + 1, __ATOMIC_RELEASE);
+    } else {
+        TRACE_PUBLISH(local_thread->dropped_events, local_thread->dropped_events + 1);
+    }
+}
+
+// Smallest of origin and the start of the events of one thread
+// (the first span starts before its thread registers and sets base_ticks)
+static unsigned long long earliest_start(const trace_thread* thread, unsigned long long origin) {
+    for(const trace_chunk* chunk = __atomic_load_n(&thread->first_chunk, __ATOMIC_ACQUIRE); chunk != NULL;
+        chunk = __atomic_load_n(&chunk->next, __ATOMIC_ACQUIRE)) {
+        int num_events = __atomic_load_n(&chunk->num_events, __ATOMIC_ACQUIRE);
+        for(int i = 0; i < num_events; i++)
+            if(chunk->events[i].start < origin)
+                origin = chunk->events[i].start;
+    }
+    return origin;
+}
+
+// Writes the events of one thread as Chrome trace events, timestamps relative to origin
+// (first: no separator yet)
+static void write_thread_events(FILE* out, const trace_thread* thread, unsigned long long origin,
+                                double ns_per_tick, int* first) {
+    for(const trace_chunk* chunk = __atomic_load_n(&thread->first_chunk, __ATOMIC_ACQUIRE); chunk != NULL;
+        chunk = __atomic_load_n(&chunk->next, __ATOMIC_ACQUIRE)) {
+        int num_events = __atomic_load_n(&chunk->num_events, __ATOMIC_ACQUIRE);
+        for(int i = 0; i < num_events; i++) {
+            const trace_event* event = &chunk->events[i];
+            double ts = (double)(event->start - origin) * ns_per_tick / 1000.0;
+            double dur = (double)(event->end - event->start) * ns_per_tick / 1000.0;
+            fprintf(out, "%s{\"name\":\"%s\",\"cat\":\"decisiontree\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                         "\"pid\":1,\"tid\":%d,\"args\":{\"depth\":%d,\"items\":%lld}}",
+                    *first ? "" : ",\n", phase_names[event->phase], ts, dur,
+                    thread->tid, event->depth, event->items);
+            *first = 0;
+        }
+    }
+}
+
+void trace_export(void) {
+    pthread_mutex_lock(&trace_lock);
+
+    if(trace_threads == NULL || __atomic_load_n(&trace_exported, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_unlock(&trace_lock);
+        return;
+    }
+
+    // threads stop recording from here on
+    __atomic_store_n(&trace_exported, 1, __ATOMIC_RELEASE);
+
+    // tick duration calibrated against the monotonic clock over the whole run
+    unsigned long long elapsed_ticks = trace_now() - base_ticks;
+    unsigned long long elapsed_ns = monotonic_ns() - base_ns;
+    double ns_per_tick = elapsed_ticks > 0 ? (double)elapsed_ns / elapsed_ticks : 1.0;
+
+    const char* path = getenv("ID3_TRACE_FILE");
+    if(path == NULL || path[0] == '\0')
+        path = TRACE_DEFAULT_FILE;
+
+    FILE* out = fopen(path, "w");
+    if(out == NULL) {
+        perror("Error opening trace file");
+    } else {
+        fprintf(out, "{\"traceEvents\":[\n");
+        unsigned long long origin = base_ticks;
+        for(trace_thread* thread = trace_threads; thread != NULL; thread = thread->next)
+            origin = earliest_start(thread, origin);
+
+        int first = 1;
+        for(trace_thread* thread = trace_threads; thread != NULL; thread = thread->next)
+            write_thread_events(out, thread, origin, ns_per_tick, &first);
+        fprintf(out, "\n],\"displayTimeUnit\":\"ns\"}\n");
+        fclose(out);
+    }
+
+    // per-depth summary over all threads
+    fprintf(stderr, "--------------------------------------------------\n");
+    fprintf(stderr, "Trace summary (%d thread(s), trace file: %s)\n\n", trace_num_threads, path);
+    fprintf(stderr, "%-14s %5s %10s %12s %12s %10s\n", "phase", "depth", "calls", "items", "total ms", "ns/item");
+
+    long long dropped = 0;
+    for(trace_thread* thread = trace_threads; thread != NULL; thread = thread->next)
+        dropped += TRACE_READ(thread->dropped_events);
+
+    for(int phase = 0; phase < TRACE_NUM_PHASES; phase++) {
+        for(int depth = 0; depth < TRACE_MAX_DEPTH; depth++) {
+            trace_counter total = { 0, 0, 0 };
+            for(trace_thread* thread = trace_threads; thread != NULL; thread = thread->next) {
+                total.calls += TRACE_READ(thread->counters[phase][depth].calls);
+                total.items += TRACE_READ(thread->counters[phase][depth].items);
+                total.ticks += TRACE_READ(thread->counters[phase][depth].ticks);
+            }
+            if(total.calls == 0)
+                continue;
+
+            double ns = total.ticks * ns_per_tick;
+            fprintf(stderr, "%-14s %5d %10lld %12lld %12.3f %10.2f\n",
+                    phase_names[phase], depth, total.calls, total.items, ns / 1e6,
+                    total.items > 0 ? ns / total.items : 0.0);
+        }
+    }
+
+    if(dropped > 0)
+        fprintf(stderr, "\n%lld event(s) beyond TRACE_MAX_EVENTS per thread were only counted.\n", dropped);
+    fprintf(stderr, "--------------------------------------------------\n");
+
+    pthread_mutex_unlock(&trace_lock);
+}
@@ -31,6 +31,7 @@ tree_node* tree_create_leaf(int class_label, const int* sample_indices, int samp
     
     /* Copiar índices de exemplos */
     node->sample_count = sample_count;
+    node->sample_capacity = sample_count;
     if (sample_count > 0 && sample_indices != NULL) {
         node->sample_indices = (int*)malloc(sample_count * sizeof(int));
         if (node->sample_indices == NULL) {
@@ -42,6 +43,7 @@ tree_node* tree_create_leaf(int class_label, const int* sample_indices, int samp
         memcpy(node->sample_indices, sample_indices, sample_count * sizeof(int));
     } else {
         node->sample_indices = NULL;
+        node->sample_capacity = 0;
     }
 
     return node;
@@ -73,6 +75,7 @@ tree_node* tree_create_internal(int attribute_index, const int* sample_indices,
     
     // Copy sample indices
     node->sample_count = sample_count;
+    node->sample_capacity = sample_count;
     if (sample_count > 0 && sample_indices != NULL) {
         node->sample_indices = (int*)malloc(sample_count * sizeof(int));
         if (node->sample_indices == NULL) {
@@ -84,6 +87,7 @@ tree_node* tree_create_internal(int attribute_index, const int* sample_indices,
         memcpy(node->sample_indices, sample_indices, sample_count * sizeof(int));
     } else {
         node->sample_indices = NULL;
+        node->sample_capacity = 0;
     }
 
     return node;
@@ -98,10 +102,33 @@ void tree_delete(tree_node* root) {
         i++;
     }
     free(root->sample_indices);
+    free(root->counts);
     free(root->children);
     free(root);
 }
 
+int tree_append_sample(tree_node* node, int sample_index) {
+    if (node == NULL) {
+        fprintf(stderr, "Invalid node\n");
+        return -1;
+    }
+
+    // Reallocation with double the size
+    if (node->sample_count == node->sample_capacity) {
+        int new_capacity = node->sample_capacity > 0 ? node->sample_capacity * 2 : 1;
+        int* new_indices = (int*)realloc(node->sample_indices, sizeof(int) * new_capacity);
+        if (!new_indices) {
+            fprintf(stderr, "Memory reallocation failed\n");
+            return -1;
+        }
+        node->sample_indices = new_indices;
+        node->sample_capacity = new_capacity;
+    }
+
+    node->sample_indices[node->sample_count++] = sample_index;
+    return 0;
+}
+
 int tree_attach_child(tree_node* parent, tree_node* child) {
     if (parent == NULL || child == NULL) {
         fprintf(stderr, "Invalid parent/child node\n");
@@ -165,4 +192,94 @@ void tree_print_rec(tree_node* node, char* prefix) {
         
         i++;
     }
-}
\ No newline at end of file
+}
+
+static int tree_save_rec(const tree_node* node, FILE* file) {
+    if(node->kind == NODE_LEAF)
+        return fprintf(file, "L %d\n", node->class_label) < 0 ? -1 : 0;
+
+    if(fprintf(file, "I %d %d\n", node->decision_attr_index, node->children_count) < 0)
+        return -1;
+    for(int i = 0; i < node->children_count; i++) {
+        if(tree_save_rec(node->children[i], file) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int tree_save(const tree_node* root, const char* path) {
+    if(root == NULL) {
+        fprintf(stderr, "Error at tree_save(): empty tree\n");
+        return -1;
+    }
+
+    FILE* file = fopen(path, "w");
+    if(file == NULL) {
+        perror("Error opening file");
+        return -1;
+    }
+
+    int status = fprintf(file, "%s %d %d\n", TREE_MODEL_MAGIC, TREE_MODEL_VERSION, NUM_ATTRIBUTES) < 0 ? -1 : 0;
+    if(status == 0)
+        status = tree_save_rec(root, file);
+    if(fclose(file) != 0)
+        status = -1;
+
+    if(status != 0)
+        fprintf(stderr, "Error at tree_save(): could not write %s\n", path);
+    return status;
+}
+
+// ID3 trees are at most NUM_ATTRIBUTES splits deep: deeper files are rejected
+static tree_node* tree_load_rec(FILE* file, int depth) {
+    char kind;
+    int value;
+    if(depth > NUM_ATTRIBUTES || fscanf(file, " %c %d", &kind, &value) != 2)
+        return NULL;
+
+    if(kind == 'L') {
+        if(value != DEMOCRAT && value != REPUBLICAN)
+            return NULL;
+        return tree_create_leaf(value, NULL, 0);
+    }
+
+    int children_count;
+    if(kind != 'I' || value < 0 || value >= NUM_ATTRIBUTES ||
+       fscanf(file, "%d", &children_count) != 1 || children_count < 0 || children_count > 2)
+        return NULL;
+
+    tree_node* node = tree_create_internal(value, NULL, 0);
+    if(node == NULL)
+        return NULL;
+
+    for(int i = 0; i < children_count; i++) {
+        tree_node* child = tree_load_rec(file, depth + 1);
+        if(child == NULL || tree_attach_child(node, child) != 0) {
+            tree_delete(child);
+            tree_delete(node);
+            return NULL;
+        }
+    }
+    return node;
+}
+
+tree_node* tree_load(const char* path) {
+    FILE* file = fopen(path, "r");
+    if(file == NULL) {
+        perror("Error opening file");
+        return NULL;
+    }
+
+    char magic[8];
+    int version, num_attributes;
+    tree_node* root = NULL;
+    if(fscanf(file, "%7s %d %d", magic, &version, &num_attributes) == 3 &&
+       strcmp(magic, TREE_MODEL_MAGIC) == 0 && version == TREE_MODEL_VERSION &&
+       num_attributes == NUM_ATTRIBUTES)
+        root = tree_load_rec(file, 0);
+
+    fclose(file);
+    if(root == NULL)
+        fprintf(stderr, "Error at tree_load(): invalid model file %s\n", path);
+    return root;
+}
@@ -0,0 +1,124 @@
+/*
+    Synthetic dataset generator.
+
+    Usage: datagen --rows N [--seed S] [--format text|binary] [--yes-prob P]
+                   [--balance P] [--noise P] [--depth D] [--output path] [--print-tree]
+
+    Writes N records in the input_read text format (default) or the binary format
+    described in input.h, to stdout or --output. Labels come from a planted random
+    tree of depth D (printed to stderr with --print-tree) with a fraction P of them
+    flipped as noise. Output depends only on the parameters and the seed.
+    Attributes are binary (y/n) in both formats; --yes-prob sets how often they are YES.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <input.h>
+#include <synth.h>
+
+#define DATAGEN_CHUNK_ROWS 65536
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s --rows N [--seed S] [--format text|binary] [--yes-prob P] "
+                    "[--balance P] [--noise P] [--depth D] [--output path] [--print-tree]\n", program);
+}
+
+int main(int argc, char** argv) {
+    synth_params params = synth_default_params();
+    unsigned long long num_rows = 0;
+    int binary = 0;
+    int print_tree = 0;
+    const char* output_path = NULL;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--print-tree") == 0) {
+            print_tree = 1;
+            continue;
+        }
+        if(i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if(strcmp(argv[i], "--rows") == 0)
+            num_rows = strtoull(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "--seed") == 0)
+            params.seed = strtoull(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "--format") == 0) {
+            i++;
+            if(strcmp(argv[i], "binary") == 0)
+                binary = 1;
+            else if(strcmp(argv[i], "text") != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--yes-prob") == 0)
+            params.yes_probability = (float)atof(argv[++i]);
+        else if(strcmp(argv[i], "--balance") == 0)
+            params.class_balance = (float)atof(argv[++i]);
+        else if(strcmp(argv[i], "--noise") == 0)
+            params.noise = (float)atof(argv[++i]);
+        else if(strcmp(argv[i], "--depth") == 0)
+            params.tree_depth = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--output") == 0)
+            output_path = argv[++i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(num_rows == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    synth_generator* generator = synth_create(&params);
+    if(generator == NULL)
+        return 1;
+
+    if(print_tree)
+        synth_print_tree(generator, stderr);
+
+    FILE* out = stdout;
+    if(output_path != NULL) {
+        out = fopen(output_path, binary ? "wb" : "w");
+        if(out == NULL) {
+            perror("Error opening output file");
+            synth_free(generator);
+            return 1;
+        }
+    }
+
+    input_record* chunk = (input_record*)malloc(DATAGEN_CHUNK_ROWS * sizeof(input_record));
+    if(chunk == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        synth_free(generator);
+        return 1;
+    }
+
+    int status = 0;
+    if(binary)
+        status = input_write_binary_header(out, num_rows);
+
+    for(unsigned long long row = 0; status == 0 && row < num_rows; row += DATAGEN_CHUNK_ROWS) {
+        int count = num_rows - row < DATAGEN_CHUNK_ROWS ? (int)(num_rows - row) : DATAGEN_CHUNK_ROWS;
+        synth_generate(generator, row, count, chunk);
+        status = binary ? input_write_binary(out, chunk, count) : input_write_records(out, chunk, count);
+    }
+
+    if(status != 0)
+        perror("Error writing output");
+
+    // buffered rows are only written (and may only fail) when the output is closed or flushed
+    if((out != stdout ? fclose(out) : fflush(out)) != 0 && status == 0) {
+        perror("Error closing output");
+        status = -1;
+    }
+
+    free(chunk);
+    synth_free(generator);
+    return status == 0 ? 0 : 1;
+}